@@ -0,0 +1,1306 @@
+// Benchmarks for the map-reduce framework
+#include "framework.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#define MAX_THREADS 32
+#define FANOUT 16
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void release(struct mr_output *output) {
+  for (size_t i = 0; i < output->count; i++) {
+    free(output->kv_lst[i].value);
+  }
+  free(output->kv_lst);
+  output->kv_lst = NULL;
+  output->count = 0;
+}
+
+// Word-count style input over a small vocabulary
+static struct mr_in_kv *gen_words(size_t count, size_t vocab) {
+  struct mr_in_kv *kv_lst = malloc(count * sizeof(*kv_lst));
+  if (kv_lst == NULL) {
+    return NULL;
+  }
+  srand(201);
+  for (size_t i = 0; i < count; i++) {
+    snprintf(kv_lst[i].key, MAX_KEY_SIZE, "%u", (unsigned)i);
+    snprintf(kv_lst[i].value, MAX_VALUE_SIZE, "w%u",
+             (unsigned)(rand() % vocab));
+  }
+  return kv_lst;
+}
+
+// Map phase timing, measured from inside the map function
+struct span {
+  double begin;
+  double end;
+} __attribute__((aligned(64)));
+
+static struct span spans[MAX_THREADS];
+static size_t span_next = 0;
+static size_t span_round = 0;
+static __thread struct span *span_self = NULL;
+static __thread size_t span_self_round = 0;
+
+static void span_reset(void) {
+  memset(spans, 0, sizeof(spans));
+  span_next = 0;
+  span_round++;
+}
+
+static double span_wall(void) {
+  double begin = 0, end = 0;
+  for (size_t i = 0; i < span_next; i++) {
+    if (i == 0 || spans[i].begin < begin) {
+      begin = spans[i].begin;
+    }
+    if (spans[i].end > end) {
+      end = spans[i].end;
+    }
+  }
+  return end - begin;
+}
+
+static void emit_map(const struct mr_in_kv *in_kv) {
+  if (span_self_round != span_round) {
+    span_self_round = span_round;
+    span_self = &spans[__atomic_fetch_add(&span_next, 1, __ATOMIC_RELAXED)];
+    span_self->begin = now();
+  }
+  for (size_t i = 0; i < FANOUT; i++) {
+    mr_emit_i(in_kv->value, "1");
+  }
+  span_self->end = now();
+}
+
+static void emit_reduce(const struct mr_out_kv *inter_kv) {}
+
+// Map-phase scaling of mr_emit_i from 1 to 32 mappers
+static int bench_emit(size_t records) {
+  struct mr_input input = {gen_words(records, 1024), records};
+  if (input.kv_lst == NULL) {
+    return -1;
+  }
+
+  double base = 0;
+  printf("%8s %12s %10s %14s %8s\n", "mappers", "records", "map_ms",
+         "emits_per_s", "speedup");
+  for (size_t m = 1; m <= MAX_THREADS; m *= 2) {
+    struct mr_output output;
+
+    span_reset();
+    if (mr_exec(&input, emit_map, m, emit_reduce, 1, &output) != 0) {
+      free(input.kv_lst);
+      return -1;
+    }
+    release(&output);
+
+    double wall = span_wall();
+    if (m == 1) {
+      base = wall;
+    }
+    printf("%8zu %12zu %10.2f %14.0f %8.2f\n", m, records, wall * 1e3,
+           records * FANOUT / wall, base / wall);
+  }
+
+  free(input.kv_lst);
+  return 0;
+}
+
+static void count_map(const struct mr_in_kv *in_kv) {
+  mr_emit_i(in_kv->value, "1");
+}
+
+static void count_reduce(const struct mr_out_kv *inter_kv) {
+  char cnt_str[MAX_VALUE_SIZE];
+  snprintf(cnt_str, MAX_VALUE_SIZE, "%zu", inter_kv->count);
+  mr_emit_f(inter_kv->key, cnt_str);
+}
+
+// Whole-job time of word count with range, hash and sampled partitioning
+static int bench_partition(size_t records) {
+  struct mr_input input = {gen_words(records, records / 4 + 1), records};
+  if (input.kv_lst == NULL) {
+    return -1;
+  }
+
+  const char *names[] = {"range", "hash", "sample"};
+  enum mr_partition modes[] = {MR_PARTITION_RANGE, MR_PARTITION_HASH,
+                               MR_PARTITION_SAMPLE};
+
+  printf("%8s %8s %8s %12s %10s\n", "mode", "mappers", "reducers",
+         "records", "job_ms");
+  for (size_t i = 0; i < 3; i++) {
+    struct mr_options opts = {.partition = modes[i]};
+    for (size_t n = 1; n <= MAX_THREADS; n *= 4) {
+      struct mr_output output;
+      double begin = now();
+      if (mr_exec_ext(&input, count_map, n, count_reduce, n, &output,
+                      &opts) != 0) {
+        free(input.kv_lst);
+        return -1;
+      }
+      double wall = now() - begin;
+      release(&output);
+      printf("%8s %8zu %8zu %12zu %10.2f\n", names[i], n, n, records,
+             wall * 1e3);
+    }
+  }
+
+  free(input.kv_lst);
+  return 0;
+}
+
+static size_t sum_values(const struct mr_out_kv *inter_kv) {
+  size_t sum = 0;
+  for (size_t i = 0; i < inter_kv->count; i++) {
+    sum += strtoull(inter_kv->value[i], NULL, 10);
+  }
+  return sum;
+}
+
+static void sum_combine(const struct mr_out_kv *inter_kv) {
+  char sum_str[MAX_VALUE_SIZE];
+  snprintf(sum_str, MAX_VALUE_SIZE, "%zu", sum_values(inter_kv));
+  mr_emit_i(inter_kv->key, sum_str);
+}
+
+static void sum_reduce(const struct mr_out_kv *inter_kv) {
+  char sum_str[MAX_VALUE_SIZE];
+  snprintf(sum_str, MAX_VALUE_SIZE, "%zu", sum_values(inter_kv));
+  mr_emit_f(inter_kv->key, sum_str);
+}
+
+// Word count with under 1% distinct keys, with and without a combiner
+static int bench_combine(size_t records) {
+  struct mr_input input = {gen_words(records, records / 200 + 1), records};
+  if (input.kv_lst == NULL) {
+    return -1;
+  }
+
+  printf("%8s %8s %12s %14s %14s %10s\n", "combine", "mappers", "records",
+         "pairs_shuffled", "bytes_shuffled", "job_ms");
+  for (size_t i = 0; i < 2; i++) {
+    struct mr_stats stats;
+    struct mr_options opts = {.combine = i == 0 ? NULL : sum_combine,
+                              .stats = &stats};
+    for (size_t m = 1; m <= MAX_THREADS; m *= 4) {
+      struct mr_output output;
+      double begin = now();
+      if (mr_exec_ext(&input, count_map, m, sum_reduce, m, &output, &opts) !=
+          0) {
+        free(input.kv_lst);
+        return -1;
+      }
+      double wall = now() - begin;
+      release(&output);
+      printf("%8s %8zu %12zu %14zu %14zu %10.2f\n", i == 0 ? "off" : "on", m,
+             records, stats.pairs_shuffled, stats.bytes_shuffled, wall * 1e3);
+    }
+  }
+
+  free(input.kv_lst);
+  return 0;
+}
+
+static void count_map_u64(const struct mr_in_kv *in_kv) {
+  mr_emit_i_u64(in_kv->value, 1);
+}
+
+static void count_reduce_u64(const struct mr_out_u64 *inter_kv) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < inter_kv->count; i++) {
+    sum += inter_kv->value[i];
+  }
+  mr_emit_f_u64(inter_kv->key, sum);
+}
+
+// Word count with string values parsed and printed by the user's functions
+// vs the same job emitting and reducing native numbers
+static int bench_typed(size_t records) {
+  struct mr_input input = {gen_words(records, records / 4 + 1), records};
+  if (input.kv_lst == NULL) {
+    return -1;
+  }
+
+  printf("%8s %8s %12s %10s %10s %10s\n", "values", "threads", "records",
+         "job_ms", "map_ms", "reduce_ms");
+  for (size_t n = 1; n <= MAX_THREADS; n *= 4) {
+    for (size_t i = 0; i < 2; i++) {
+      struct mr_stats stats;
+      struct mr_options opts = {.stats = &stats,
+                                .reduce_u64 = i == 1 ? count_reduce_u64
+                                                     : NULL};
+      struct mr_output output;
+      double begin = now();
+      if (mr_exec_ext(&input, i == 0 ? count_map : count_map_u64, n,
+                      i == 0 ? sum_reduce : NULL, n, &output,
+                      &opts) != 0) {
+        free(input.kv_lst);
+        return -1;
+      }
+      double wall = now() - begin;
+      release(&output);
+      printf("%8s %8zu %12zu %10.2f %10.2f %10.2f\n",
+             i == 0 ? "string" : "u64", n, records, wall * 1e3,
+             stats.phases[MR_PHASE_MAP].wall * 1e3,
+             stats.phases[MR_PHASE_REDUCE].wall * 1e3);
+    }
+  }
+
+  free(input.kv_lst);
+  return 0;
+}
+
+// Reduce-phase time of word count by a string reduce parsing every value,
+// a typed reduce, and the built-in aggregates, with no call per key
+static int bench_aggregate(size_t records) {
+  struct mr_input input = {gen_words(records, records / 4 + 1), records};
+  if (input.kv_lst == NULL) {
+    return -1;
+  }
+
+  const char *names[] = {"string", "u64", "count", "sum_u64"};
+  printf("%8s %8s %12s %10s %10s\n", "reduce", "threads", "records",
+         "job_ms", "reduce_ms");
+  for (size_t n = 1; n <= MAX_THREADS; n *= 4) {
+    for (size_t i = 0; i < 4; i++) {
+      struct mr_stats stats;
+      struct mr_options opts = {.stats = &stats};
+      void (*map)(const struct mr_in_kv *) = count_map_u64;
+      if (i == 0 || i == 2) {
+        map = count_map;
+      }
+      if (i == 1) {
+        opts.reduce_u64 = count_reduce_u64;
+      } else if (i > 1) {
+        opts.aggregate = i == 2 ? MR_AGG_COUNT : MR_AGG_SUM_U64;
+      }
+
+      struct mr_output output;
+      double begin = now();
+      if (mr_exec_ext(&input, map, n, i == 0 ? sum_reduce : NULL, n, &output,
+                      &opts) != 0) {
+        free(input.kv_lst);
+        return -1;
+      }
+      double wall = now() - begin;
+      release(&output);
+      printf("%8s %8zu %12zu %10.2f %10.2f\n", names[i], n, records,
+             wall * 1e3, stats.phases[MR_PHASE_REDUCE].wall * 1e3);
+    }
+  }
+
+  free(input.kv_lst);
+  return 0;
+}
+
+// Reduce-phase time of word count with each reducer's input laid out as
+// pairs or as columns, for a string reduce and an aggregate over the values
+static int bench_layout(size_t records) {
+  struct mr_input input = {gen_words(records, records / 16 + 1), records};
+  if (input.kv_lst == NULL) {
+    return -1;
+  }
+
+  const char *partitions[] = {"range", "hash", "sample"};
+  const char *layouts[] = {"columns", "pairs"};
+  printf("%10s %8s %8s %8s %12s %10s %10s\n", "partition", "reduce",
+         "layout", "threads", "records", "job_ms", "reduce_ms");
+  for (size_t p = 0; p < 3; p++) {
+    for (size_t a = 0; a < 2; a++) {
+      for (size_t n = 1; n <= MAX_THREADS; n *= 4) {
+        for (size_t l = 0; l < 2; l++) {
+          struct mr_stats stats;
+          struct mr_options opts = {
+              .partition = (enum mr_partition)p,
+              .stats = &stats,
+              .aggregate = a == 1 ? MR_AGG_SUM_U64 : MR_AGG_NONE,
+              .layout = (enum mr_layout)l,
+          };
+          struct mr_output output;
+          double begin = now();
+          if (mr_exec_ext(&input, a == 1 ? count_map_u64 : count_map, n,
+                          a == 1 ? NULL : sum_reduce, n, &output,
+                          &opts) != 0) {
+            free(input.kv_lst);
+            return -1;
+          }
+          double wall = now() - begin;
+          release(&output);
+          printf("%10s %8s %8s %8zu %12zu %10.2f %10.2f\n", partitions[p],
+                 a == 1 ? "sum_u64" : "string", layouts[l], n, records,
+                 wall * 1e3, stats.phases[MR_PHASE_REDUCE].wall * 1e3);
+        }
+      }
+    }
+  }
+
+  free(input.kv_lst);
+  return 0;
+}
+
+// Word count pushed into a session in batches, the time from the last
+// batch to the output against one mr_exec over the whole input, and how
+// long results for the first half take to peek at
+static int bench_session(size_t records) {
+  struct mr_input input = {gen_words(records, records / 16 + 1), records};
+  if (input.kv_lst == NULL) {
+    return -1;
+  }
+
+  printf("%8s %8s %12s %10s %10s %10s %10s\n", "batch", "threads",
+         "records", "push_ms", "peek_ms", "close_ms", "exec_ms");
+  for (size_t n = 1; n <= MAX_THREADS; n *= 4) {
+    struct mr_output output;
+    double begin = now();
+    if (mr_exec(&input, count_map, n, sum_reduce, n, &output) != 0) {
+      free(input.kv_lst);
+      return -1;
+    }
+    double exec = now() - begin;
+    release(&output);
+
+    for (size_t batch = records / 100; batch <= records / 10; batch *= 10) {
+      struct mr_session *session =
+          mr_session_open(count_map, n, sum_reduce, n, NULL);
+      double peek = 0;
+      begin = now();
+      for (size_t i = 0; session != NULL && i < records; i += batch) {
+        size_t count = records - i < batch ? records - i : batch;
+        if (mr_session_push(session, &input.kv_lst[i], count) != 0) {
+          break;
+        }
+        // Results for the first half, while the rest is still to come
+        if (i < records / 2 && i + count >= records / 2) {
+          double peek_begin = now();
+          if (mr_session_peek(session, &output) == 0) {
+            release(&output);
+          }
+          peek = now() - peek_begin;
+        }
+      }
+      double push = now() - begin - peek;
+      begin = now();
+      if (mr_session_close(session, &output) != 0) {
+        free(input.kv_lst);
+        return -1;
+      }
+      double close = now() - begin;
+      release(&output);
+      printf("%8zu %8zu %12zu %10.2f %10.2f %10.2f %10.2f\n", batch, n,
+             records, push * 1e3, peek * 1e3, close * 1e3, exec * 1e3);
+    }
+  }
+
+  free(input.kv_lst);
+  return 0;
+}
+
+// Many small word counts on one pool, run one after another with mr_exec
+// vs all submitted at once and then waited for
+static int bench_async(size_t jobs) {
+  size_t records = 10000;
+  struct mr_input input = {gen_words(records, records / 4 + 1), records};
+  struct mr_pool *pool = mr_pool_create(4);
+  struct mr_handle **handles = malloc(jobs * sizeof(*handles));
+  if (input.kv_lst == NULL || pool == NULL || handles == NULL) {
+    free(input.kv_lst);
+    mr_pool_destroy(pool);
+    free(handles);
+    return -1;
+  }
+
+  int res = 0;
+  struct mr_options opts = {.pool = pool};
+  printf("%8s %8s %8s %12s %10s %10s\n", "mode", "jobs", "threads",
+         "records", "total_ms", "jobs_per_s");
+  for (size_t n = 1; n <= 4 && res == 0; n *= 2) {
+    struct mr_output output;
+    double begin = now();
+    for (size_t j = 0; j < jobs && res == 0; j++) {
+      res = mr_exec_ext(&input, count_map, n, sum_reduce, n, &output, &opts);
+      release(&output);
+    }
+    double serial = now() - begin;
+
+    begin = now();
+    for (size_t j = 0; j < jobs; j++) {
+      handles[j] = mr_submit(&input, count_map, n, sum_reduce, n, &opts);
+    }
+    for (size_t j = 0; j < jobs; j++) {
+      if (handles[j] == NULL || mr_wait(handles[j], &output) != 0) {
+        res = -1;
+        continue;
+      }
+      release(&output);
+    }
+    double async = now() - begin;
+
+    printf("%8s %8zu %8zu %12zu %10.2f %10.0f\n", "serial", jobs, n, records,
+           serial * 1e3, jobs / serial);
+    printf("%8s %8zu %8zu %12zu %10.2f %10.0f\n", "submit", jobs, n, records,
+           async * 1e3, jobs / async);
+  }
+
+  free(input.kv_lst);
+  mr_pool_destroy(pool);
+  free(handles);
+  return res;
+}
+
+// Turns a count back into a key, so the next stage counts the counts
+static void invert_map(const struct mr_in_kv *in_kv) {
+  mr_emit_i(in_kv->value, in_kv->key);
+}
+
+// Runs the stages as separate mr_exec calls, converting each output back
+// into input records and freeing it before the next stage
+static int exec_stages(const struct mr_input *input, size_t mapper_count,
+                       const struct mr_stage *stages, size_t count,
+                       struct mr_output *output) {
+  struct mr_input next = *input;
+  struct mr_in_kv *kv_lst = NULL;
+  int res = 0;
+  for (size_t k = 0; k < count && res == 0; k++) {
+    res = mr_exec(&next, stages[k].map, mapper_count, stages[k].reduce,
+                  stages[k].reducer_count, output);
+    free(kv_lst);
+    kv_lst = NULL;
+    if (res != 0 || k + 1 == count) {
+      break;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < output->count; i++) {
+      n += output->kv_lst[i].count;
+    }
+    kv_lst = malloc((n > 0 ? n : 1) * sizeof(*kv_lst));
+    res = kv_lst == NULL ? -1 : 0;
+    for (size_t i = 0, j = 0; i < output->count && res == 0; i++) {
+      for (size_t v = 0; v < output->kv_lst[i].count; v++, j++) {
+        memcpy(kv_lst[j].key, output->kv_lst[i].key, MAX_KEY_SIZE);
+        memcpy(kv_lst[j].value, output->kv_lst[i].value[v], MAX_VALUE_SIZE);
+      }
+    }
+    release(output);
+    next = (struct mr_input){kv_lst, n};
+    mapper_count = stages[k].reducer_count;
+  }
+  return res;
+}
+
+// Word count, count of counts and a histogram of those as a pipeline vs
+// three mr_exec calls with each output turned back into input records
+static int bench_pipeline(size_t records) {
+  struct mr_input input = {gen_words(records, records / 2 + 1), records};
+  if (input.kv_lst == NULL) {
+    return -1;
+  }
+
+  printf("%8s %12s %12s %10s %10s\n", "threads", "records", "stage1_keys",
+         "exec_ms", "pipe_ms");
+  for (size_t n = 1; n <= MAX_THREADS; n *= 4) {
+    struct mr_stats stats;
+    struct mr_options opts = {.stats = &stats};
+    struct mr_stage stages[3] = {
+        {count_map, count_reduce, n, &opts},
+        {invert_map, count_reduce, n, NULL},
+        {invert_map, count_reduce, n, NULL},
+    };
+    struct mr_output output;
+    double begin = now();
+    if (exec_stages(&input, n, stages, 3, &output) != 0) {
+      free(input.kv_lst);
+      return -1;
+    }
+    double exec = now() - begin;
+    release(&output);
+
+    begin = now();
+    if (mr_pipeline(&input, n, stages, 3, &output) != 0) {
+      free(input.kv_lst);
+      return -1;
+    }
+    double pipe = now() - begin;
+    release(&output);
+    printf("%8zu %12zu %12zu %10.2f %10.2f\n", n, records,
+           stats.bytes_output / sizeof(struct mr_pair), exec * 1e3,
+           pipe * 1e3);
+  }
+
+  free(input.kv_lst);
+  return 0;
+}
+
+// Keeps about one record in 80, a map with almost no work per record
+static void filter_map(const struct mr_in_kv *in_kv) {
+  if (in_kv->value[1] == '7' && in_kv->value[2] == '7') {
+    mr_emit_i(in_kv->value, "1");
+  }
+}
+
+static void filter_map_batch(const struct mr_in_kv *kv_lst, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    filter_map(&kv_lst[i]);
+  }
+}
+
+// Map-phase time per record of a trivial map called once per record vs
+// once per batch
+static int bench_batch(size_t records) {
+  struct mr_input input = {gen_words(records, 64 * 1024), records};
+  if (input.kv_lst == NULL) {
+    return -1;
+  }
+
+  printf("%8s %8s %12s %10s %14s\n", "map", "mappers", "records", "map_ms",
+         "ns_per_record");
+  for (size_t n = 1; n <= MAX_THREADS; n *= 4) {
+    for (size_t i = 0; i < 2; i++) {
+      struct mr_stats stats;
+      struct mr_options opts = {.stats = &stats,
+                                .aggregate = MR_AGG_COUNT,
+                                .map_batch = i == 1 ? filter_map_batch
+                                                    : NULL};
+      struct mr_output output;
+      if (mr_exec_ext(&input, filter_map, n, NULL, 1, &output, &opts) != 0) {
+        free(input.kv_lst);
+        return -1;
+      }
+      release(&output);
+      double wall = stats.phases[MR_PHASE_MAP].wall;
+      printf("%8s %8zu %12zu %10.2f %14.2f\n", i == 0 ? "record" : "batch",
+             n, records, wall * 1e3, wall * 1e9 / records);
+    }
+  }
+
+  free(input.kv_lst);
+  return 0;
+}
+
+// Seconds spent inside the map functions below, one mapper only
+static double map_seconds;
+
+// Emits FANOUT pairs per record, like a tokenizer, one call per pair
+static void fanout_map(const struct mr_in_kv *kv_lst, size_t count) {
+  double begin = now();
+  for (size_t i = 0; i < count; i++) {
+    for (size_t j = 0; j < FANOUT; j++) {
+      mr_emit_i(kv_lst[i].value, kv_lst[i].key);
+    }
+  }
+  map_seconds += now() - begin;
+}
+
+// The same pairs with one call per record
+static void fanout_map_batch(const struct mr_in_kv *kv_lst, size_t count) {
+  double begin = now();
+  const char *keys[FANOUT], *values[FANOUT];
+  for (size_t i = 0; i < count; i++) {
+    for (size_t j = 0; j < FANOUT; j++) {
+      keys[j] = kv_lst[i].value;
+      values[j] = kv_lst[i].key;
+    }
+    mr_emit_i_batch(keys, values, FANOUT);
+  }
+  map_seconds += now() - begin;
+}
+
+// Time spent emitting FANOUT pairs per record, one pair vs one record's
+// pairs per call
+static int bench_emit_batch(size_t records) {
+  struct mr_input input = {gen_words(records, 1024), records};
+  if (input.kv_lst == NULL) {
+    return -1;
+  }
+
+  printf("%8s %12s %12s %10s %12s\n", "emit", "records", "pairs", "map_ms",
+         "ns_per_pair");
+  for (size_t i = 0; i < 2; i++) {
+    struct mr_options opts = {.aggregate = MR_AGG_COUNT,
+                              .map_batch = i == 0 ? fanout_map
+                                                  : fanout_map_batch};
+    struct mr_output output;
+    map_seconds = 0;
+    if (mr_exec_ext(&input, NULL, 1, NULL, 1, &output, &opts) != 0) {
+      free(input.kv_lst);
+      return -1;
+    }
+    release(&output);
+    printf("%8s %12zu %12zu %10.2f %12.2f\n", i == 0 ? "pair" : "batch",
+           records, records * FANOUT, map_seconds * 1e3,
+           map_seconds * 1e9 / (records * FANOUT));
+  }
+
+  free(input.kv_lst);
+  return 0;
+}
+
+// Allocations per job for growing inputs, malloc'd vs arena-backed output
+static int bench_alloc(size_t records) {
+  printf("%8s %12s %8s %12s %10s\n", "output", "records", "threads",
+         "allocations", "job_ms");
+  for (size_t n = records / 64 > 0 ? records / 64 : 1; n <= records; n *= 8) {
+    struct mr_input input = {gen_words(n, 1024), n};
+    if (input.kv_lst == NULL) {
+      return -1;
+    }
+
+    for (size_t i = 0; i < 2; i++) {
+      struct mr_stats stats;
+      struct mr_options opts = {.stats = &stats, .arena_output = i == 1};
+      struct mr_output output;
+      double begin = now();
+      if (mr_exec_ext(&input, count_map, 8, count_reduce, 8, &output,
+                      &opts) != 0) {
+        free(input.kv_lst);
+        return -1;
+      }
+      double wall = now() - begin;
+      if (opts.arena_output) {
+        mr_release_output(&output);
+      } else {
+        release(&output);
+      }
+      printf("%8s %12zu %8d %12zu %10.2f\n", i == 0 ? "malloc" : "arena", n,
+             8, stats.allocations, wall * 1e3);
+    }
+    free(input.kv_lst);
+  }
+  return 0;
+}
+
+// Input whose values are random 15-character keys
+static struct mr_in_kv *gen_random_keys(size_t count) {
+  struct mr_in_kv *kv_lst = gen_words(count, 1);
+  if (kv_lst == NULL) {
+    return NULL;
+  }
+  for (size_t i = 0; i < count; i++) {
+    for (size_t j = 0; j < MAX_VALUE_SIZE - 1; j++) {
+      kv_lst[i].value[j] = 'a' + rand() % 26;
+    }
+  }
+  return kv_lst;
+}
+
+static void pass_map(const struct mr_in_kv *in_kv) {
+  mr_emit_i(in_kv->value, in_kv->key);
+}
+
+static void first_reduce(const struct mr_out_kv *inter_kv) {
+  mr_emit_f(inter_kv->key, inter_kv->value[0]);
+}
+
+// Shuffle throughput of the merge sort vs the radix sort grouping
+static int bench_sort(size_t records) {
+  const char *inputs[] = {"words", "random"};
+  const char *names[] = {"merge", "radix"};
+
+  printf("%8s %8s %12s %10s %14s\n", "keys", "sort", "records", "job_ms",
+         "pairs_per_s");
+  for (size_t k = 0; k < 2; k++) {
+    struct mr_input input = {k == 0 ? gen_words(records, records / 8 + 1)
+                                    : gen_random_keys(records),
+                             records};
+    if (input.kv_lst == NULL) {
+      return -1;
+    }
+
+    for (size_t i = 0; i < 2; i++) {
+      struct mr_options opts = {.grouping = i == 0 ? MR_GROUP_MERGE
+                                                   : MR_GROUP_RADIX};
+      struct mr_output output;
+      double begin = now();
+      if (mr_exec_ext(&input, pass_map, 1, first_reduce, 1, &output,
+                      &opts) != 0) {
+        free(input.kv_lst);
+        return -1;
+      }
+      double wall = now() - begin;
+      release(&output);
+      printf("%8s %8s %12zu %10.2f %14.0f\n", inputs[k], names[i], records,
+             wall * 1e3, records / wall);
+    }
+    free(input.kv_lst);
+  }
+  return 0;
+}
+
+// Jobs with millions of output keys; hashed buckets make every reducer's
+// output span the whole key space, so the final merge does real work
+static int bench_merge(size_t records) {
+  struct mr_input input = {gen_random_keys(records), records};
+  if (input.kv_lst == NULL) {
+    return -1;
+  }
+
+  printf("%8s %12s %12s %10s\n", "reducers", "records", "output_keys",
+         "job_ms");
+  for (size_t r = 1; r <= MAX_THREADS; r *= 2) {
+    struct mr_options opts = {.partition = MR_PARTITION_HASH,
+                              .grouping = MR_GROUP_RADIX,
+                              .arena_output = true};
+    struct mr_output output;
+    double begin = now();
+    if (mr_exec_ext(&input, pass_map, r, first_reduce, r, &output, &opts) !=
+        0) {
+      free(input.kv_lst);
+      return -1;
+    }
+    double wall = now() - begin;
+    printf("%8zu %12zu %12zu %10.2f\n", r, records, output.count,
+           wall * 1e3);
+    mr_release_output(&output);
+  }
+
+  free(input.kv_lst);
+  return 0;
+}
+
+// Jobs with one output key per record: time to build the final output and
+// to free it, copied into malloc'd or arena output vs written in place
+static int bench_output(size_t records) {
+  struct mr_input input = {gen_random_keys(records), records};
+  if (input.kv_lst == NULL) {
+    return -1;
+  }
+
+  const char *names[] = {"malloc", "arena", "direct"};
+  printf("%8s %8s %12s %10s %10s %10s %10s\n", "output", "reducers",
+         "records", "job_ms", "reduce_ms", "output_ms", "free_ms");
+  for (size_t r = 1; r <= MAX_THREADS; r *= 4) {
+    for (size_t i = 0; i < 3; i++) {
+      struct mr_stats stats;
+      struct mr_options opts = {.stats = &stats,
+                                .grouping = MR_GROUP_RADIX,
+                                .arena_output = i == 1,
+                                .direct_output = i == 2};
+      struct mr_output output;
+      double begin = now();
+      if (mr_exec_ext(&input, pass_map, r, first_reduce, r, &output, &opts) !=
+          0) {
+        free(input.kv_lst);
+        return -1;
+      }
+      double wall = now() - begin;
+      begin = now();
+      if (i == 0) {
+        release(&output);
+      } else {
+        mr_release_output(&output);
+      }
+      double freed = now() - begin;
+      printf("%8s %8zu %12zu %10.2f %10.2f %10.2f %10.2f\n", names[i], r,
+             records, wall * 1e3, stats.phases[MR_PHASE_REDUCE].wall * 1e3,
+             stats.phases[MR_PHASE_OUTPUT].wall * 1e3, freed * 1e3);
+    }
+  }
+
+  free(input.kv_lst);
+  return 0;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Latency of many tiny jobs on fresh threads vs a persistent pool
+static int bench_tiny(size_t jobs) {
+  struct mr_input input = {gen_words(64, 16), 64};
+  double *lat = malloc(jobs * sizeof(*lat));
+  struct mr_pool *pool = mr_pool_create(16);
+  if (input.kv_lst == NULL || lat == NULL || pool == NULL) {
+    free(input.kv_lst);
+    free(lat);
+    mr_pool_destroy(pool);
+    return -1;
+  }
+
+  int res = 0;
+  printf("%8s %8s %8s %10s %10s\n", "pool", "threads", "jobs", "p50_us",
+         "p99_us");
+  for (size_t i = 0; i < 2 && res == 0; i++) {
+    struct mr_options opts = {.pool = i == 0 ? NULL : pool};
+    for (size_t n = 2; n <= 8 && res == 0; n *= 2) {
+      for (size_t j = 0; j < jobs; j++) {
+        struct mr_output output;
+        double begin = now();
+        if (mr_exec_ext(&input, count_map, n, count_reduce, n, &output,
+                        &opts) != 0) {
+          res = -1;
+          break;
+        }
+        lat[j] = now() - begin;
+        release(&output);
+      }
+      qsort(lat, jobs, sizeof(*lat), cmp_double);
+      printf("%8s %8zu %8zu %10.1f %10.1f\n", i == 0 ? "off" : "on", n, jobs,
+             lat[jobs / 2] * 1e6, lat[jobs * 99 / 100] * 1e6);
+    }
+  }
+
+  mr_pool_destroy(pool);
+  free(lat);
+  free(input.kv_lst);
+  return res;
+}
+
+// Synthetic key distributions of the suite
+enum dataset { UNIFORM, ZIPF, UNIQUE, HOT, DATASET_COUNT };
+
+static const char *dataset_names[DATASET_COUNT] = {"uniform", "zipf",
+                                                   "unique", "hot"};
+
+// xorshift64*, so datasets are the same on every run and platform
+static uint64_t rng_next(uint64_t *state) {
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 0x2545F4914F6CDD1DULL;
+}
+
+// Word ranks following Zipf's law with exponent 1 over vocab words
+static int zipf_ranks(uint32_t *ranks, size_t count, size_t vocab,
+                      uint64_t *rng) {
+  double *cdf = malloc(vocab * sizeof(*cdf));
+  if (cdf == NULL) {
+    return -1;
+  }
+  double sum = 0;
+  for (size_t i = 0; i < vocab; i++) {
+    sum += 1.0 / (i + 1);
+    cdf[i] = sum;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    double u = (rng_next(rng) >> 11) * 0x1.0p-53 * sum;
+    size_t lo = 0, hi = vocab - 1;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (cdf[mid] < u) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    ranks[i] = lo;
+  }
+  free(cdf);
+  return 0;
+}
+
+// Word-count input whose words follow the dataset's distribution
+// Uniform and Zipf draw from count / 16 words, unique has a new word per
+// record, hot repeats a single word
+static struct mr_in_kv *gen_dataset(enum dataset kind, size_t count) {
+  struct mr_in_kv *kv_lst = malloc(count * sizeof(*kv_lst));
+  uint32_t *ranks = malloc(count * sizeof(*ranks));
+  if (kv_lst == NULL || ranks == NULL) {
+    free(kv_lst);
+    free(ranks);
+    return NULL;
+  }
+
+  uint64_t rng = 0x9E3779B97F4A7C15ULL;
+  size_t vocab = count / 16 > 0 ? count / 16 : 1;
+  if (kind == ZIPF && zipf_ranks(ranks, count, vocab, &rng) != 0) {
+    free(kv_lst);
+    free(ranks);
+    return NULL;
+  }
+  for (size_t i = 0; i < count; i++) {
+    uint32_t word = kind == UNIFORM ? rng_next(&rng) % vocab
+                    : kind == ZIPF  ? ranks[i]
+                    : kind == UNIQUE ? i
+                                     : 0;
+    memset(&kv_lst[i], 0, sizeof(kv_lst[i]));
+    snprintf(kv_lst[i].key, MAX_KEY_SIZE, "%u", (unsigned)i);
+    snprintf(kv_lst[i].value, MAX_VALUE_SIZE, "w%u", (unsigned)word);
+  }
+  free(ranks);
+  return kv_lst;
+}
+
+// Restarts the peak RSS count, so each configuration gets its own
+static void peak_rss_reset(void) {
+  FILE *f = fopen("/proc/self/clear_refs", "w");
+  if (f != NULL) {
+    fputs("5", f);
+    fclose(f);
+  }
+}
+
+// Peak resident set size in KiB since the last reset
+static size_t peak_rss_kib(void) {
+  FILE *f = fopen("/proc/self/status", "r");
+  char line[256];
+  size_t kib = 0;
+  while (f != NULL && fgets(line, sizeof(line), f) != NULL) {
+    if (sscanf(line, "VmHWM: %zu kB", &kib) == 1) {
+      break;
+    }
+  }
+  if (f != NULL) {
+    fclose(f);
+  }
+  if (kib == 0) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    kib = ru.ru_maxrss;
+  }
+  return kib;
+}
+
+// Emits FANOUT pairs per record, one call per pair
+static void spread_map(const struct mr_in_kv *in_kv) {
+  for (size_t j = 0; j < FANOUT; j++) {
+    mr_emit_i(in_kv->value, in_kv->key);
+  }
+}
+
+// Peak RSS growth of a fan-out job without a mapper budget and with
+// shrinking ones, next to what all mappers' budgets add up to
+// The budgets bound intermediate pairs; RSS also holds the final output
+// and the reducers' read buffers
+static int bench_backpressure(size_t records) {
+  struct mr_input input = {gen_words(records, records / 4 + 1), records};
+  if (input.kv_lst == NULL) {
+    return -1;
+  }
+
+  static const size_t budgets[] = {0, 64 << 20, 16 << 20, 4 << 20};
+  printf("%10s %8s %12s %12s %10s %10s %10s\n", "budget_mib", "mappers",
+         "pairs", "spill_runs", "cap_mib", "rss_mib", "job_ms");
+  for (size_t n = 1; n <= 4; n *= 4) {
+    for (size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++) {
+      struct mr_stats stats;
+      struct mr_options opts = {.stats = &stats,
+                                .aggregate = MR_AGG_COUNT,
+                                .mapper_budget = budgets[b]};
+      struct mr_output output;
+      peak_rss_reset();
+      size_t base = peak_rss_kib();
+      double begin = now();
+      if (mr_exec_ext(&input, spread_map, n, NULL, n, &output, &opts) != 0) {
+        free(input.kv_lst);
+        return -1;
+      }
+      double wall = now() - begin;
+      size_t peak = peak_rss_kib();
+      release(&output);
+      printf("%10zu %8zu %12zu %12zu %10zu %10.1f %10.2f\n", budgets[b] >> 20,
+             n, stats.pairs_emitted, stats.spill_runs, (budgets[b] * n) >> 20,
+             (peak - base) / 1024.0, wall * 1e3);
+    }
+  }
+
+  free(input.kv_lst);
+  return 0;
+}
+
+// Word count over every dataset and input size from 10^4 up to max_records,
+// for a grid of mapper and reducer counts, repeating each job reps times
+// Prints one CSV row per configuration
+static int bench_suite(size_t max_records, size_t reps) {
+  static const size_t threads[] = {1, 4, 16};
+  size_t thread_count = sizeof(threads) / sizeof(threads[0]);
+  double *lat = malloc(reps * sizeof(*lat));
+  if (lat == NULL) {
+    return -1;
+  }
+
+  printf("dataset,records,mappers,reducers,reps,keys,records_per_s,"
+         "p50_ms,p99_ms,peak_rss_kib\n");
+  for (size_t n = 10000; n <= max_records; n *= 10) {
+    for (size_t d = 0; d < DATASET_COUNT; d++) {
+      struct mr_input input = {gen_dataset(d, n), n};
+      if (input.kv_lst == NULL) {
+        free(lat);
+        return -1;
+      }
+
+      for (size_t mi = 0; mi < thread_count; mi++) {
+        for (size_t ri = 0; ri < thread_count; ri++) {
+          size_t m = threads[mi], r = threads[ri], keys = 0;
+          peak_rss_reset();
+          for (size_t j = 0; j < reps; j++) {
+            struct mr_output output;
+            double begin = now();
+            if (mr_exec(&input, count_map, m, count_reduce, r, &output) !=
+                0) {
+              free(input.kv_lst);
+              free(lat);
+              return -1;
+            }
+            lat[j] = now() - begin;
+            keys = output.count;
+            release(&output);
+          }
+          size_t rss = peak_rss_kib();
+
+          double total = 0;
+          for (size_t j = 0; j < reps; j++) {
+            total += lat[j];
+          }
+          qsort(lat, reps, sizeof(*lat), cmp_double);
+          printf("%s,%zu,%zu,%zu,%zu,%zu,%.0f,%.3f,%.3f,%zu\n",
+                 dataset_names[d], n, m, r, reps, keys, n * reps / total,
+                 lat[reps / 2] * 1e3, lat[reps * 99 / 100] * 1e3, rss);
+          fflush(stdout);
+        }
+      }
+      free(input.kv_lst);
+    }
+  }
+
+  free(lat);
+  return 0;
+}
+
+// Job latency and reducer imbalance on skewed words, with and without
+// splitting hot keys over all reducers
+#define SKEW_THREADS 8
+
+static int bench_skew(size_t records) {
+  const size_t reps = 21, threads = SKEW_THREADS;
+  double *lat = malloc(reps * sizeof(*lat));
+  if (lat == NULL) {
+    return -1;
+  }
+
+  // Reducer CPU time rather than wall time, which also counts waiting for
+  // a CPU when there are more threads than cores
+  printf("%8s %6s %12s %6s %10s %10s %14s %14s\n", "dataset", "split",
+         "records", "hot", "p50_ms", "p99_ms", "reduce_min_ms",
+         "reduce_max_ms");
+  enum dataset kinds[] = {ZIPF, HOT};
+  for (size_t k = 0; k < 2; k++) {
+    struct mr_input input = {gen_dataset(kinds[k], records), records};
+    if (input.kv_lst == NULL) {
+      free(lat);
+      return -1;
+    }
+
+    for (size_t split = 0; split < 2; split++) {
+      struct mr_stats stats;
+      struct mr_thread_stats ts[2 * SKEW_THREADS];
+      struct mr_options opts = {.stats = &stats,
+                                .thread_stats = ts,
+                                .merge = split ? sum_reduce : NULL};
+      double slowest = 0, fastest = 0;
+      for (size_t j = 0; j < reps; j++) {
+        struct mr_output output;
+        double begin = now();
+        if (mr_exec_ext(&input, count_map, threads, sum_reduce, threads,
+                        &output, &opts) != 0) {
+          free(input.kv_lst);
+          free(lat);
+          return -1;
+        }
+        lat[j] = now() - begin;
+        release(&output);
+        double lo = ts[threads].cpu, hi = ts[threads].cpu;
+        for (size_t r = threads + 1; r < 2 * threads; r++) {
+          lo = ts[r].cpu < lo ? ts[r].cpu : lo;
+          hi = ts[r].cpu > hi ? ts[r].cpu : hi;
+        }
+        slowest += hi / reps;
+        fastest += lo / reps;
+      }
+      qsort(lat, reps, sizeof(*lat), cmp_double);
+      printf("%8s %6s %12zu %6zu %10.2f %10.2f %14.3f %14.3f\n",
+             dataset_names[kinds[k]], split ? "on" : "off", records,
+             stats.hot_keys, lat[reps / 2] * 1e3, lat[reps * 99 / 100] * 1e3,
+             fastest * 1e3, slowest * 1e3);
+    }
+    free(input.kv_lst);
+  }
+
+  free(lat);
+  return 0;
+}
+
+// Keys sharing a prefix of random length, so compares stop at varied bytes
+static char (*gen_keys(size_t count))[MAX_KEY_SIZE] {
+  char(*keys)[MAX_KEY_SIZE] = malloc(count * MAX_KEY_SIZE);
+  if (keys == NULL) {
+    return NULL;
+  }
+  uint64_t rng = 201;
+  for (size_t i = 0; i < count; i++) {
+    size_t len = 1 + rng_next(&rng) % (MAX_KEY_SIZE - 1);
+    size_t prefix = rng_next(&rng) % (len + 1);
+    memset(keys[i], 0, MAX_KEY_SIZE);
+    memset(keys[i], 'k', prefix);
+    for (size_t j = prefix; j < len; j++) {
+      keys[i][j] = 'a' + rng_next(&rng) % 4;
+    }
+  }
+  return keys;
+}
+
+static int old_key_cmp(const char *a, const char *b) {
+  return memcmp(a, b, MAX_KEY_SIZE);
+}
+
+static int strncmp_key_cmp(const char *a, const char *b) {
+  return strncmp(a, b, MAX_KEY_SIZE);
+}
+
+static int new_key_cmp(const char *a, const char *b) {
+  return mr_key_cmp(a, b);
+}
+
+static int new_key_eq(const char *a, const char *b) {
+  return mr_key_eq(a, b);
+}
+
+static int old_key_eq(const char *a, const char *b) {
+  return memcmp(a, b, MAX_KEY_SIZE) == 0;
+}
+
+// Per-key cost of comparing neighbouring keys, passes rounds over all keys
+static double time_cmp(char (*keys)[MAX_KEY_SIZE], size_t count,
+                       size_t rounds, int (*cmp)(const char *, const char *)) {
+  volatile int sink = 0;
+  double begin = now();
+  for (size_t r = 0; r < rounds; r++) {
+    int acc = 0;
+    for (size_t i = 1; i < count; i++) {
+      acc += cmp(keys[i - 1], keys[i]) < 0;
+    }
+    sink += acc;
+  }
+  return (now() - begin) / (rounds * (count - 1));
+}
+
+// Byte-at-a-time FNV-1a, the usual string hash, as a baseline
+static size_t fnv_key_hash(const char *key) {
+  size_t h = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < MAX_KEY_SIZE; i++) {
+    h = (h ^ (unsigned char)key[i]) * 0x100000001b3ull;
+  }
+  return h;
+}
+
+static double time_hash(char (*keys)[MAX_KEY_SIZE], size_t count,
+                        size_t rounds, bool bytewise) {
+  volatile size_t sink = 0;
+  double begin = now();
+  for (size_t r = 0; r < rounds; r++) {
+    size_t acc = 0;
+    for (size_t i = 0; i < count; i++) {
+      acc += (bytewise ? fnv_key_hash(keys[i]) : mr_key_hash(keys[i])) % 31;
+    }
+    sink += acc;
+  }
+  return (now() - begin) / (rounds * count);
+}
+
+// Per-key cost of the key primitives against their byte-loop versions
+static int bench_keys(size_t count) {
+  count = count < 2 ? 2 : count;
+  char(*keys)[MAX_KEY_SIZE] = gen_keys(count);
+  if (keys == NULL) {
+    return -1;
+  }
+  size_t rounds = 1 + 50000000 / count;
+
+  printf("%-12s %-8s %10s\n", "op", "impl", "ns_per_key");
+  printf("%-12s %-8s %10.2f\n", "order", "strncmp",
+         time_cmp(keys, count, rounds, strncmp_key_cmp) * 1e9);
+  printf("%-12s %-8s %10.2f\n", "order", "memcmp",
+         time_cmp(keys, count, rounds, old_key_cmp) * 1e9);
+  printf("%-12s %-8s %10.2f\n", "order", "mr_key",
+         time_cmp(keys, count, rounds, new_key_cmp) * 1e9);
+  printf("%-12s %-8s %10.2f\n", "equal", "memcmp",
+         time_cmp(keys, count, rounds, old_key_eq) * 1e9);
+  printf("%-12s %-8s %10.2f\n", "equal", "mr_key",
+         time_cmp(keys, count, rounds, new_key_eq) * 1e9);
+  printf("%-12s %-8s %10.2f\n", "hash", "fnv1a",
+         time_hash(keys, count, rounds, true) * 1e9);
+  printf("%-12s %-8s %10.2f\n", "hash", "mr_key",
+         time_hash(keys, count, rounds, false) * 1e9);
+
+  free(keys);
+  return 0;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s emit|emit_batch|partition|combine|typed|aggregate|batch|"
+          "layout|session|pipeline|alloc|sort|merge|output|keys|skew|"
+          "backpressure "
+          "[records]\n"
+          "       %s tiny|async [jobs]\n"
+          "       %s suite [max_records] [reps]\n",
+          prog, prog, prog);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  size_t records = argc > 2 ? strtoull(argv[2], NULL, 10) : 1024;
+  int res = -1;
+  if (strcmp(argv[1], "emit") == 0) {
+    res = bench_emit(records);
+  } else if (strcmp(argv[1], "emit_batch") == 0) {
+    res = bench_emit_batch(records);
+  } else if (strcmp(argv[1], "partition") == 0) {
+    res = bench_partition(records);
+  } else if (strcmp(argv[1], "combine") == 0) {
+    res = bench_combine(records);
+  } else if (strcmp(argv[1], "typed") == 0) {
+    res = bench_typed(records);
+  } else if (strcmp(argv[1], "aggregate") == 0) {
+    res = bench_aggregate(records);
+  } else if (strcmp(argv[1], "batch") == 0) {
+    res = bench_batch(records);
+  } else if (strcmp(argv[1], "layout") == 0) {
+    res = bench_layout(records);
+  } else if (strcmp(argv[1], "session") == 0) {
+    res = bench_session(records);
+  } else if (strcmp(argv[1], "pipeline") == 0) {
+    res = bench_pipeline(records);
+  } else if (strcmp(argv[1], "async") == 0) {
+    res = bench_async(records);
+  } else if (strcmp(argv[1], "alloc") == 0) {
+    res = bench_alloc(records);
+  } else if (strcmp(argv[1], "tiny") == 0) {
+    res = bench_tiny(records);
+  } else if (strcmp(argv[1], "sort") == 0) {
+    res = bench_sort(records);
+  } else if (strcmp(argv[1], "merge") == 0) {
+    res = bench_merge(records);
+  } else if (strcmp(argv[1], "output") == 0) {
+    res = bench_output(records);
+  } else if (strcmp(argv[1], "skew") == 0) {
+    res = bench_skew(records);
+  } else if (strcmp(argv[1], "backpressure") == 0) {
+    res = bench_backpressure(records);
+  } else if (strcmp(argv[1], "keys") == 0) {
+    res = bench_keys(records);
+  } else if (strcmp(argv[1], "suite") == 0) {
+    size_t reps = argc > 3 ? strtoull(argv[3], NULL, 10) : 5;
+    res = bench_suite(argc > 2 ? records : 1000000, reps > 0 ? reps : 1);
+  } else {
+    usage(argv[0]);
+    return 1;
+  }
+  return res == 0 ? 0 : 1;
+}
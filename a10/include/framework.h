@@ -0,0 +1,347 @@
+#pragma once
+
+#include "interface.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define MR_CACHE_LINE 64
+
+// One fixed-width intermediate or final key-value pair
+// Keys and values are zero-padded, so memcmp on keys orders like strcmp
+struct mr_pair {
+  char key[MAX_KEY_SIZE];
+  char value[MAX_VALUE_SIZE];
+};
+
+// Copies a string into a fixed-width field, truncating and zero-padding it
+static inline void mr_copy_field(char *dst, const char *src, size_t size) {
+  size_t len = strnlen(src, size - 1);
+  memcpy(dst, src, len);
+  memset(dst + len, 0, size - len);
+}
+
+// Chunk of an append-only buffer
+struct mr_seg {
+  struct mr_seg *next;
+  size_t count; // pairs used
+  size_t cap;   // pairs available
+  struct mr_pair pairs[];
+};
+
+// Append-only pair buffer written by exactly one thread
+// Growing links a new segment, so pairs never move once written
+struct mr_buffer {
+  struct mr_seg *head;
+  struct mr_seg *tail;
+  size_t count; // pairs over all segments
+};
+
+struct mr_chunk;
+
+// Bump allocator over mmap'd chunks, owned by one thread at a time
+// Nothing is freed individually; the whole arena goes at the end of a job
+struct mr_arena {
+  struct mr_chunk *head; // most recent chunk
+  size_t next_size;      // size of the next chunk to map
+  size_t maps;           // chunks mapped so far
+};
+
+// Arena position to roll back to, for scratch allocations
+struct mr_arena_mark {
+  struct mr_chunk *chunk;
+  size_t used;
+};
+
+enum mr_role { MR_MAPPER, MR_REDUCER };
+
+// What intermediate values hold, numbers sitting in the first bytes
+enum mr_values { MR_VALUES_STRING, MR_VALUES_U64, MR_VALUES_F64 };
+
+// Sorted pairs of a reducer split into columns, CSR-style: key k's values
+// are values[offsets[k]] up to values[offsets[k + 1]]
+struct mr_columns {
+  char (*keys)[MAX_KEY_SIZE]; // distinct keys in order
+  char (*values)[MAX_VALUE_SIZE];
+  size_t *offsets; // count + 1 entries
+  size_t count;
+};
+
+struct mr_job;
+struct mr_merge;
+struct mr_cpu_order;
+struct mr_spill_run;
+struct mr_pool_task;
+
+// Per-thread state for one mapper or reducer
+// Aligned to a cache line so neighbouring workers never share one
+struct mr_worker {
+  struct mr_job *job;
+  enum mr_role role;
+  size_t index;
+  struct mr_arena arena;           // all memory this worker allocates
+  struct mr_buffer out;            // emitted pairs
+  struct mr_buffer *parts;         // mapper buckets, one per reducer if hashed
+  size_t part_count;
+  size_t emitted;                  // map or reduce emits, before combining
+  size_t shuffled;                 // pairs handed on to reducers
+  size_t buffered;                 // pairs buffered since the last spill
+  bool combining;                  // emits come from the combiner
+  bool reducing_hot;               // emits are partial results of hot keys
+  struct mr_buffer hot_out;        // those partial results
+  size_t records;                  // input records mapped or keys reduced
+  double wall;                     // seconds spent, if stats are wanted
+  double cpu;
+  int cpu_id;                      // CPU the worker finished on
+  bool pinned;                     // thread affinity set for this job
+  struct mr_pair *run;             // pairs sorted by key, local to the worker
+  size_t run_count;
+  struct mr_group *groups;         // groups of run, reducer-local grouping
+  size_t group_count;
+  struct mr_columns cols;          // gathered input, unless laid out as pairs
+  struct mr_pair *final;           // reducer output sorted by key
+  size_t final_count;
+  size_t final_keys;               // distinct keys in final
+  char (*scratch)[MAX_VALUE_SIZE]; // reducer value array for one key
+  size_t scratch_cap;
+  uint64_t *numbers;               // the same, packed for a typed reduce
+  size_t number_cap;
+  struct mr_spill_run *spill_runs; // mapper runs with a memory budget
+  size_t spill_count;
+  size_t spill_cap;
+  int spill_fd;                    // spill file, -1 until first used
+  size_t spill_size;               // bytes written to the spill file
+  struct mr_arena_mark spill_mark; // arena position before any pairs
+  bool direct;                     // final pairs go straight into kv_lst
+  struct mr_out_kv *slots;         // this reducer's part of kv_lst
+  size_t slot_count;               // one slot per group it reduces
+  size_t slot_used;
+  char (*slab)[MAX_VALUE_SIZE];    // next free final value
+  size_t slab_free;                // values left in the current slab
+  struct mr_arena values;          // slabs of final values, kept as output
+  bool failed;                     // ran out of memory
+  pthread_t thread;
+} __attribute__((aligned(MR_CACHE_LINE)));
+
+// Sorted run of one mapper bucket, in memory or in its spill file
+struct mr_spill_run {
+  size_t part;               // bucket the pairs came from
+  const struct mr_pair *mem; // NULL if the run is in the spill file
+  size_t offset;             // byte offset in the spill file
+  size_t count;
+};
+
+// Sorted run being consumed by a k-way merge
+struct mr_run {
+  const struct mr_pair *pos;
+  const struct mr_pair *end;
+  size_t index; // breaks ties between equal keys, lowest first
+};
+
+// Range of equal keys in the sorted intermediate pairs
+struct mr_group {
+  size_t begin;
+  size_t end;
+};
+
+// State of one mr_exec call
+struct mr_job {
+  struct mr_options opts;
+  struct mr_arena arena; // allocations of the coordinating thread
+  const struct mr_input *input;
+  const struct mr_input *slices; // input of each mapper, or NULL to split
+  void (*map)(const struct mr_in_kv *);
+  void (*reduce)(const struct mr_out_kv *);
+  enum mr_values values;
+  size_t mapper_count;
+  size_t reducer_count;
+  struct mr_worker *mappers;
+  struct mr_worker *reducers;
+  struct mr_cpu_order *cpu_order; // CPUs to pin workers to, or NULL
+
+  struct mr_pair *pairs; // all intermediate pairs sorted by key
+  size_t pair_count;
+  struct mr_group *groups; // one per distinct intermediate key
+  size_t group_count;
+  struct mr_columns cols; // the same pairs as columns, instead of pairs
+  size_t spill_pairs;     // pairs a mapper buffers before spilling, 0 never
+  struct mr_group *hot;   // groups of keys split over all reducers
+  size_t hot_count;
+  char (*bounds)[MAX_KEY_SIZE]; // first key of each reducer if sampled/spilled
+  size_t *bound_index;          // position of that key among distinct keys
+  struct mr_merge *merge;       // final merge state while assembling output
+  size_t maps;                  // chunks mapped by released worker arenas
+  size_t output_allocs;         // allocations made for the final output
+  double merge_cpu;             // CPU seconds of helper threads in mr_assemble
+  bool direct;                  // reducers write the output in place
+  struct mr_arena direct_out;   // kv_lst written in place, until handed over
+  double lap_wall;              // coordinator clocks at the last phase change
+  double lap_cpu;
+};
+
+// Placed right before kv_lst of an arena-backed output
+struct mr_output_head {
+  struct mr_arena arena;
+} __attribute__((aligned(MR_CACHE_LINE)));
+
+// Worker of the calling thread, NULL outside of map and reduce
+extern __thread struct mr_worker *mr_self;
+
+// Orders keys like memcmp over all MAX_KEY_SIZE bytes
+// One 16-byte SSE2 compare finds the first differing byte, SSE2 being part
+// of every x86-64 CPU; elsewhere two big-endian word compares do the same
+static inline int mr_key_cmp(const char *a, const char *b) {
+#if defined(__SSE2__) && MAX_KEY_SIZE == 16
+  __m128i x = _mm_loadu_si128((const __m128i *)a);
+  __m128i y = _mm_loadu_si128((const __m128i *)b);
+  unsigned diff = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) ^ 0xffff;
+  if (diff == 0) {
+    return 0;
+  }
+  unsigned i = __builtin_ctz(diff);
+  return (unsigned char)a[i] - (unsigned char)b[i];
+#elif MAX_KEY_SIZE == 16 && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  uint64_t x[2], y[2];
+  memcpy(x, a, sizeof(x));
+  memcpy(y, b, sizeof(y));
+  for (size_t i = 0; i < 2; i++) {
+    if (x[i] != y[i]) {
+      return __builtin_bswap64(x[i]) < __builtin_bswap64(y[i]) ? -1 : 1;
+    }
+  }
+  return 0;
+#else
+  return memcmp(a, b, MAX_KEY_SIZE);
+#endif
+}
+
+static inline bool mr_key_eq(const char *a, const char *b) {
+#if defined(__SSE2__) && MAX_KEY_SIZE == 16
+  __m128i x = _mm_loadu_si128((const __m128i *)a);
+  __m128i y = _mm_loadu_si128((const __m128i *)b);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) == 0xffff;
+#else
+  return memcmp(a, b, MAX_KEY_SIZE) == 0;
+#endif
+}
+
+// Appends the index-th pair of a sorted sequence to columns with room for
+// it, starting a new key where it differs from the last
+static inline void mr_columns_push(struct mr_columns *cols,
+                                   const struct mr_pair *pair, size_t index) {
+  if (cols->count == 0 || !mr_key_eq(cols->keys[cols->count - 1], pair->key)) {
+    memcpy(cols->keys[cols->count], pair->key, MAX_KEY_SIZE);
+    cols->offsets[cols->count++] = index;
+  }
+  memcpy(cols->values[index], pair->value, MAX_VALUE_SIZE);
+}
+
+// Hashes the full zero-padded key as two 64-bit words
+static inline size_t mr_key_hash(const char *key) {
+  uint64_t lo, hi;
+  memcpy(&lo, key, sizeof(lo));
+  memcpy(&hi, key + sizeof(lo), sizeof(hi));
+
+  uint64_t h = lo * 0x9e3779b97f4a7c15ull ^ hi;
+  h ^= h >> 32;
+  h *= 0xd6e8feb86659fd93ull;
+  h ^= h >> 32;
+  return (size_t)h;
+}
+
+// affinity.c
+int mr_placement_init(struct mr_job *job);
+void mr_place(struct mr_worker *worker);
+void mr_unplace(struct mr_worker *worker);
+
+// aggregate.c
+void mr_aggregate(struct mr_worker *reducer, const char *key,
+                  const char *values, size_t stride, size_t count);
+enum mr_values mr_aggregate_values(enum mr_aggregate agg);
+
+// arena.c
+void *mr_arena_alloc(struct mr_arena *arena, size_t size);
+struct mr_arena_mark mr_arena_mark(const struct mr_arena *arena);
+void mr_arena_reset(struct mr_arena *arena, struct mr_arena_mark mark);
+void mr_arena_release(struct mr_arena *arena);
+void mr_arena_append(struct mr_arena *dst, struct mr_arena *src);
+
+// buffer.c
+int mr_buffer_push(struct mr_arena *arena, struct mr_buffer *buf,
+                   const struct mr_pair *pair);
+void mr_buffer_clear(struct mr_buffer *buf);
+void mr_buffer_copy(const struct mr_buffer *buf, struct mr_pair *dst);
+
+// direct.c
+int mr_direct_layout(struct mr_job *job);
+int mr_direct_emit(struct mr_worker *reducer, const char *key,
+                   const char *value);
+int mr_direct_assemble(struct mr_job *job, struct mr_output *output);
+
+// hotkey.c
+int mr_split_hot(struct mr_job *job);
+int mr_merge_hot(struct mr_job *job);
+
+// mapreduce.c
+int mr_run_workers(struct mr_job *job, struct mr_worker *workers, size_t count,
+                   void *(*fn)(void *));
+char (*mr_scratch(struct mr_worker *worker, size_t count))[MAX_VALUE_SIZE];
+void mr_reduce_kv(struct mr_worker *reducer, const struct mr_out_kv *kv);
+int mr_combine_local(struct mr_worker *mapper);
+int mr_job_init(struct mr_job *job, void (*map)(const struct mr_in_kv *),
+                size_t mapper_count, void (*reduce)(const struct mr_out_kv *),
+                size_t reducer_count, const struct mr_options *options);
+int mr_map_phase(struct mr_job *job, struct mr_stats *stats);
+int mr_shuffle_phase(struct mr_job *job, struct mr_stats *stats);
+int mr_reduce_phase(struct mr_job *job, struct mr_stats *stats,
+                    struct mr_output *output);
+size_t mr_job_release(struct mr_job *job);
+
+// merge.c
+int mr_prepare_final(struct mr_worker *reducer);
+int mr_assemble(struct mr_job *job, struct mr_output *output);
+
+// pool.c
+int mr_pool_run(struct mr_pool *pool, struct mr_worker *workers, size_t count,
+                void *(*fn)(void *));
+struct mr_pool_task *mr_pool_start(struct mr_pool *pool, void *(*fn)(void *),
+                                   void *arg);
+void mr_pool_join(struct mr_pool_task *task);
+
+// spill.c
+int mr_spill(struct mr_worker *mapper);
+int mr_spill_finish(struct mr_worker *mapper);
+int mr_spill_bounds(struct mr_job *job);
+void mr_spill_reduce(struct mr_worker *reducer);
+
+// sort.c
+int mr_sort_pairs(struct mr_arena *arena, struct mr_pair *pairs, size_t count,
+                  enum mr_grouping grouping);
+
+// stats.c
+double mr_wall_time(void);
+double mr_cpu_time(void);
+bool mr_timed(const struct mr_job *job);
+void mr_worker_begin(struct mr_worker *worker);
+void mr_worker_end(struct mr_worker *worker);
+void mr_lap(struct mr_job *job, struct mr_stats *stats, enum mr_phase phase);
+void mr_collect_workers(struct mr_job *job, struct mr_stats *stats,
+                        const struct mr_worker *workers, size_t count,
+                        enum mr_phase phase, size_t first);
+
+// shuffle.c
+int mr_find_groups(struct mr_arena *arena, const struct mr_pair *pairs,
+                   size_t count, struct mr_group **groups, size_t *group_count);
+int mr_shuffle(struct mr_job *job);
+int mr_shuffle_runs(struct mr_job *job, struct mr_run *runs, size_t count);
+void mr_merge_runs(struct mr_run *runs, size_t count, struct mr_pair *dst);
+int mr_gather_bucket(struct mr_job *job, struct mr_worker *reducer);
+size_t mr_lower_bound(const struct mr_pair *pairs, size_t count,
+                      const char *key);
+int mr_sample_bounds(struct mr_job *job);
+int mr_gather_range(struct mr_job *job, struct mr_worker *reducer);
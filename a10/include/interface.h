@@ -1,6 +1,9 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
 #define MAX_KEY_SIZE 16
 #define MAX_VALUE_SIZE 16
@@ -24,6 +27,19 @@ struct mr_out_kv {
   size_t count;                  // number of output value strings
 };
 
+// Used for intermediate key-value pairs emitted as numbers
+struct mr_out_u64 {
+  char key[MAX_KEY_SIZE];
+  const uint64_t *value; // intermediate values (array)
+  size_t count;          // number of intermediate values
+};
+
+struct mr_out_f64 {
+  char key[MAX_KEY_SIZE];
+  const double *value; // intermediate values (array)
+  size_t count;        // number of intermediate values
+};
+
 // Used for final output
 struct mr_output {
   struct mr_out_kv *kv_lst; // final output (array)
@@ -41,6 +57,277 @@ int mr_exec(const struct mr_input *input,         // input key-value pairs
             struct mr_output *output // pointer to a final output buffer
 );
 
+// How intermediate keys are assigned to reducers
+enum mr_partition {
+  MR_PARTITION_RANGE, // sorted keys split into equal contiguous ranges
+  MR_PARTITION_HASH,  // key hash picks the reducer at emit time, no global sort
+  // Split keys sampled from the mappers' sorted runs bound each reducer's
+  // range, so each reducer merges only its own range, no global sort
+  MR_PARTITION_SAMPLE,
+};
+
+// How intermediate pairs are sorted to group equal keys
+enum mr_grouping {
+  MR_GROUP_MERGE, // comparison merge sort
+  MR_GROUP_RADIX, // byte-wise radix sort of the fixed-width keys
+};
+
+// How a reducer holds its keys and values while reducing
+enum mr_layout {
+  // Keys, values and per-key offsets in three arrays; reduce reads each
+  // key's values where they lie
+  MR_LAYOUT_COLUMNS,
+  // Sorted key-value pairs, each key's values copied out for reduce
+  MR_LAYOUT_PAIRS,
+};
+
+// Where mapper and reducer threads run; mapper i and reducer i share a CPU
+enum mr_placement {
+  MR_PLACE_NONE,    // wherever the scheduler puts them
+  MR_PLACE_COMPACT, // consecutive CPUs, filling one NUMA node first
+  MR_PLACE_SCATTER, // CPUs taken from each NUMA node in turn
+  MR_PLACE_LIST,    // mr_options.cpus, reused from the start if too short
+};
+
+// Set of parked worker threads that can be reused across jobs
+struct mr_pool;
+
+// Job whose input arrives in batches, see mr_session_open
+struct mr_session;
+
+// Job running in the background, see mr_submit
+struct mr_handle;
+
+// Steps of a job, in the order they run
+enum mr_phase {
+  MR_PHASE_MAP,     // map and combine, each mapper sorting its own pairs
+  MR_PHASE_SHUFFLE, // global merge of the mapper runs, range partitioning
+  MR_PHASE_REDUCE,  // grouping and reduce, each reducer sorting its output
+  MR_PHASE_OUTPUT,  // merging the reducer outputs into the final output
+  MR_PHASE_COUNT,
+};
+
+// Time spent in one phase, in seconds
+struct mr_phase_stats {
+  double wall;
+  double cpu;        // summed over all threads working on the phase
+  double thread_min; // wall time of the fastest mapper or reducer
+  double thread_max; // wall time of the slowest one
+};
+
+// Work done by one mapper or reducer
+struct mr_thread_stats {
+  size_t records; // input records mapped, or keys reduced
+  size_t emitted; // pairs emitted
+  double wall;    // seconds from start to finish
+  double cpu;     // seconds of CPU time
+  int cpu_id;     // CPU the thread finished on, -1 if unknown
+};
+
+// Counters filled in by mr_exec_ext when requested
+struct mr_stats {
+  size_t pairs_emitted;  // intermediate pairs emitted by map
+  size_t pairs_shuffled; // intermediate pairs handed to reducers
+  size_t bytes_shuffled; // key and value bytes handed to reducers
+  size_t allocations;    // heap and mmap allocations made for the job
+  size_t spill_runs;     // sorted runs written to spill files
+  size_t bytes_spilled;  // pair bytes written to spill files
+  size_t bytes_emitted;  // key and value bytes emitted by map
+  size_t bytes_output;   // key and value bytes emitted by reduce
+  size_t hot_keys;       // keys whose values were split over reducers
+  size_t mapper_count;
+  size_t reducer_count;
+  struct mr_phase_stats phases[MR_PHASE_COUNT];
+};
+
+// Reductions mr_exec_ext can run itself, with no call per key
+// The _U64 and _F64 ones take the numbers maps emit with mr_emit_i_u64 or
+// mr_emit_i_f64; each emits one final value per key, in decimal
+enum mr_aggregate {
+  MR_AGG_NONE,
+  MR_AGG_COUNT, // number of values, emitted with mr_emit_i
+  MR_AGG_SUM_U64,
+  MR_AGG_MIN_U64,
+  MR_AGG_MAX_U64,
+  MR_AGG_MEAN_U64, // written like a double
+  MR_AGG_SUM_F64,
+  MR_AGG_MIN_F64,
+  MR_AGG_MAX_F64,
+  MR_AGG_MEAN_F64,
+};
+
+// Optional settings for mr_exec_ext
+// A zero-initialized struct gives the same behaviour as mr_exec
+struct mr_options {
+  enum mr_partition partition;
+  // Called per mapper on its own output, grouped by key, before the shuffle
+  // Emits replacement pairs with mr_emit_i, e.g. partial sums
+  void (*combine)(const struct mr_out_kv *);
+  struct mr_stats *stats; // filled in after the job if not NULL
+  // Filled in per mapper and then per reducer if not NULL
+  // Must hold mapper_count + reducer_count entries
+  struct mr_thread_stats *thread_stats;
+  // Backs the output by a few mapped chunks instead of one malloc per key
+  // Such output must be freed with mr_release_output, not free_output
+  bool arena_output;
+  // Runs mappers and reducers on parked pool threads instead of new ones
+  // Each mapper and reducer still gets its own thread
+  struct mr_pool *pool;
+  enum mr_grouping grouping;
+  // Bytes of intermediate pairs all mappers may buffer, 0 for no limit
+  // Past its share a mapper sorts its pairs into a run in a temporary file,
+  // and reducers stream merge the runs; the output stays the same
+  size_t memory_budget;
+  // Bytes of intermediate pairs one mapper may hold, 0 for no limit
+  // Counts the room sorting them takes too; at the cap the mapper flushes
+  // what it buffered early as a sorted run in a temporary file, as with
+  // memory_budget, so fan-out maps run in bounded memory
+  size_t mapper_budget;
+  // Pins each thread to one CPU, its buffers then come from the local node
+  // Falls back to unpinned threads where a CPU cannot be used
+  enum mr_placement placement;
+  const int *cpus; // CPU numbers for MR_PLACE_LIST
+  size_t cpu_count;
+  // Splits hot keys over all reducers if set
+  // Range partitioning only, with no memory or mapper budget; jobs setting
+  // merge with anything else fail
+  // A key is hot with over half a reducer's fair share of the pairs; each
+  // reducer reduces a slice of its values, and merge gets what they emitted,
+  // grouped by key, to emit the final pairs with mr_emit_f
+  void (*merge)(const struct mr_out_kv *);
+  // Reduce writes final pairs straight into the output, keys into kv_lst
+  // and values into slabs that mr_release_output unmaps all at once
+  // Needs range or sampled partitioning, no memory or mapper budget and no
+  // merge, and each reducer emitting increasing keys, at most one per key it
+  // reduces, as word count does; otherwise the output is built as with
+  // arena_output
+  // Must be freed with mr_release_output either way
+  bool direct_output;
+  // Reduce for maps that emit numbers with mr_emit_i_u64 or mr_emit_i_f64,
+  // called instead of reduce (which may then be NULL) with each key's values
+  // in one native array; no number is ever turned into a string before the
+  // final mr_emit_f_u64 or mr_emit_f_f64
+  // At most one may be set, and not with combine or merge
+  void (*reduce_u64)(const struct mr_out_u64 *);
+  void (*reduce_f64)(const struct mr_out_f64 *);
+  // Map called on a few thousand consecutive records at a time, instead of
+  // map (which may then be NULL); each mapper's batches split its own
+  // contiguous slice of the input, in order
+  void (*map_batch)(const struct mr_in_kv *kv_lst, size_t count);
+  // Built-in reduce run instead of reduce (which may then be NULL)
+  // Not with a typed reduce, combine or merge
+  enum mr_aggregate aggregate;
+  // Pairs whenever merge is set, hot keys being split into runs of pairs
+  enum mr_layout layout;
+};
+
+// One job of a chain run by mr_pipeline
+struct mr_stage {
+  void (*map)(const struct mr_in_kv *);
+  void (*reduce)(const struct mr_out_kv *);
+  size_t reducer_count;             // also the next stage's mapper count
+  const struct mr_options *options; // NULL for the defaults
+};
+
+// Same as mr_exec, with optional settings (NULL for the defaults)
+// With MR_PARTITION_HASH each reducer only sorts the keys hashed to it,
+// and the final output is still sorted by key
+// Returns 0 on success, -1 on failure
+int mr_exec_ext(const struct mr_input *input,
+                void (*map)(const struct mr_in_kv *), size_t mapper_count,
+                void (*reduce)(const struct mr_out_kv *), size_t reducer_count,
+                struct mr_output *output, const struct mr_options *options);
+
+// Starts a job like mr_exec_ext whose input is pushed in batches
+// Each batch is mapped as it is pushed, its pairs sorted and merged with
+// those of earlier batches, so closing only merges a few sorted runs and
+// reduces them; the output is the same as from mr_exec_ext over all
+// batches in order (with a combine, as long as it may run on any split
+// of the input, as with memory_budget); mr_session_peek gives the results
+// for what has been pushed so far at any point
+// Reducers split keys by range whatever the partition; thread_stats gets
+// the last batch's mappers
+// Returns NULL on failure, or with a memory or mapper budget
+struct mr_session *mr_session_open(void (*map)(const struct mr_in_kv *),
+                                   size_t mapper_count,
+                                   void (*reduce)(const struct mr_out_kv *),
+                                   size_t reducer_count,
+                                   const struct mr_options *options);
+
+// Maps count more input records, split over the mappers like mr_exec's
+// input; kv_lst may be reused as soon as this returns
+// Returns 0 on success, -1 on failure, after which closing fails too
+int mr_session_push(struct mr_session *session, const struct mr_in_kv *kv_lst,
+                    size_t count);
+
+// Reduces everything pushed so far into output, leaving the session open
+// The output is what closing now would give, so results are available
+// while input still arrives; each call merges and reduces all pairs pushed
+// so far, so it costs about as much as closing
+// Returns 0 on success, -1 on failure
+int mr_session_peek(struct mr_session *session, struct mr_output *output);
+
+// Reduces everything pushed into output and frees the session
+// Returns 0 on success, -1 on failure
+int mr_session_close(struct mr_session *session, struct mr_output *output);
+
+// Starts the same job as mr_exec_ext and returns without waiting for it
+// The job runs on a thread of options->pool if set, else on a new one;
+// any number of jobs may run at once, sharing one pool, each emit going
+// to the job of the map or reduce that made it
+// input, the options' pointers and the functions' data must stay valid
+// until mr_wait returns
+// Returns NULL on failure
+struct mr_handle *mr_submit(const struct mr_input *input,
+                            void (*map)(const struct mr_in_kv *),
+                            size_t mapper_count,
+                            void (*reduce)(const struct mr_out_kv *),
+                            size_t reducer_count,
+                            const struct mr_options *options);
+
+// Waits for a submitted job, fills in its output and frees the handle
+// With output NULL the job's output is freed instead
+// Returns what mr_exec_ext would have
+int mr_wait(struct mr_handle *handle, struct mr_output *output);
+
+// Runs count jobs in a chain, each stage's output being the next one's
+// input; stage k + 1 has as many mappers as stage k has reducers, mapper i
+// mapping what reducer i emitted, sorted by key, straight out of its
+// buffers, so only the last stage's output is ever assembled
+// The first stage maps input with mapper_count mappers; each stage's stats
+// cover that stage alone, and only the last may write output in place
+// Values for a key reach a stage in the order of the previous stage's
+// output only if that one split keys by range without hot keys, so other
+// partitions need reduces that do not depend on value order
+// Returns 0 on success, -1 on failure
+int mr_pipeline(const struct mr_input *input, size_t mapper_count,
+                const struct mr_stage *stages, size_t count,
+                struct mr_output *output);
+
+// Creates a pool with thread_count parked threads
+// The pool grows when a job needs more threads than are idle
+// Returns NULL on failure
+struct mr_pool *mr_pool_create(size_t thread_count);
+
+// Stops and joins all pool threads, no job may be using the pool
+void mr_pool_destroy(struct mr_pool *pool);
+
+// Frees an output produced with arena_output or direct_output set
+void mr_release_output(struct mr_output *output);
+
+// Prints a job's stats as a table, with per-thread rows if threads is not
+// NULL (as filled in through mr_options.thread_stats)
+void mr_stats_print(FILE *out, const struct mr_stats *stats,
+                    const struct mr_thread_stats *threads);
+
+// Maps a file of packed mr_in_kv records read-only as input, no copying
+// Fields must be NUL-terminated, as mr_pack writes them
+// Returns 0 on success, -1 on failure or if the size is not whole records
+int mr_input_map(const char *path, struct mr_input *input);
+
+// Unmaps an input loaded with mr_input_map
+void mr_input_unmap(struct mr_input *input);
+
 // Called from the map function for the intermediate output
 // To emit one intermediate key-value pair
 // Can be called multiple times within the same map function
@@ -48,6 +335,19 @@ int mr_exec(const struct mr_input *input,         // input key-value pairs
 // Returns 0 on success, -1 on failure
 int mr_emit_i(const char *key, const char *value);
 
+// Same as mr_emit_i for count pairs at once, keys[i] with values[i]
+// Mixes freely with mr_emit_i; a memory budget is checked once per batch
+// Returns 0 on success, -1 on failure, emitting nothing if any key or
+// value is NULL
+int mr_emit_i_batch(const char *const *keys, const char *const *values,
+                    size_t count);
+
+// Same as mr_emit_i for jobs with reduce_u64 or reduce_f64 set, whose
+// maps emit numbers only
+// Returns 0 on success, -1 on failure or if the job takes other values
+int mr_emit_i_u64(const char *key, uint64_t value);
+int mr_emit_i_f64(const char *key, double value);
+
 // Called from the reduce function for the final output
 // To emit one final key-value pair
 // Can be called multiple times within the same reduce function
@@ -55,3 +355,11 @@ int mr_emit_i(const char *key, const char *value);
 // The final output is the union of all the emitted key-value pairs
 // Returns 0 on success, -1 on failure
 int mr_emit_f(const char *key, const char *value);
+
+// Same as mr_emit_f with the value written in decimal, doubles with up to
+// 8 significant digits so they fit MAX_VALUE_SIZE; integers over 15 digits
+// are cut short like any longer string
+// Can be called from any reduce function
+// Returns 0 on success, -1 on failure
+int mr_emit_f_u64(const char *key, uint64_t value);
+int mr_emit_f_f64(const char *key, double value);
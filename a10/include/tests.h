@@ -21,4 +21,70 @@ bool partition_input(void);
 bool partition_intermediate(void);
 bool full_map_reduce(void);
 bool multiple_calls(void);
+bool combine_map_reduce(void);
+bool pool_calls(void);
+bool spill_map_reduce(void);
+bool mapped_input(void);
+bool phase_stats(void);
+bool placement(void);
+bool split_reduce(void);
+bool sample_partition(void);
+bool direct_output(void);
+bool typed_reduce(void);
+bool aggregates(void);
+bool batch_map(void);
+bool batch_emit(void);
+bool column_layout(void);
+bool mapper_budget(void);
+bool streaming(void);
+bool async_jobs(void);
+bool chained_jobs(void);
+void print_phase_stats(void);
 void free_output(struct mr_output *);
+
+// Inputs, maps, reduces and checks the tests share
+
+// map_and_reduce.c: word count over ex_in_kv_lst, 57 distinct words
+extern struct mr_in_kv ex_in_kv_lst[MAX_DATA_SIZE];
+void amr_map(const struct mr_in_kv *);
+void amr_reduce(const struct mr_out_kv *);
+int amr_cmp(struct mr_output *);
+
+// single_reduce.c
+extern struct mr_in_kv sr_in_kv_lst[MAX_DATA_SIZE];
+extern size_t sr_call_count;
+void sr_reduce(const struct mr_out_kv *);
+int sr_cmp(void);
+
+// number_of_mappers_reducers.c
+extern bool too_many_threads;
+void nom_map(const struct mr_in_kv *);
+void nom_reduce(const struct mr_out_kv *);
+void nor_map(const struct mr_in_kv *);
+void nor_reduce(const struct mr_out_kv *);
+void nmr_reset(void);
+int thread_cmp(size_t);
+
+// partition.c
+extern bool too_many_partitions;
+void pin_map(const struct mr_in_kv *);
+void pin_reduce(const struct mr_out_kv *);
+int partition_cmp(struct mr_in_kv *, size_t);
+void partitions_reset(void);
+
+// combine.c: word count summing partial counts
+void cmb_map(const struct mr_in_kv *);
+void cmb_combine(const struct mr_out_kv *);
+void cmb_reduce(const struct mr_out_kv *);
+
+// spill_map_reduce.c: keeps every value in the order reduce got it
+void spl_map(const struct mr_in_kv *);
+void spl_reduce(const struct mr_out_kv *);
+int spl_cmp(struct mr_output *, struct mr_output *);
+
+// typed_reduce.c: word count with numbers
+void typ_map(const struct mr_in_kv *);
+void typ_reduce(const struct mr_out_u64 *);
+
+// column_layout.c: emits the record index under the word
+void col_map(const struct mr_in_kv *);
@@ -0,0 +1,167 @@
+#define _GNU_SOURCE
+#include "framework.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MR_MAX_NODES 64
+
+// CPUs in the order workers are placed on them
+struct mr_cpu_order {
+  cpu_set_t allowed; // CPUs the coordinating thread may use
+  int *cpus;
+  size_t count;
+};
+
+// Mask the calling thread had before mr_place pinned it, for mr_unplace
+static __thread cpu_set_t saved_mask;
+
+// Parses a sysfs CPU list such as "0-3,8-11" into the set
+static void parse_cpu_list(const char *list, cpu_set_t *set) {
+  const char *p = list;
+  while (*p != '\0' && *p != '\n') {
+    char *end;
+    long first = strtol(p, &end, 10), last = first;
+    if (end == p) {
+      return;
+    }
+    if (*end == '-') {
+      p = end + 1;
+      last = strtol(p, &end, 10);
+    }
+    for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+      CPU_SET(cpu, set);
+    }
+    p = *end == ',' ? end + 1 : end;
+  }
+}
+
+// Reads the CPUs of each NUMA node, or reports one node with every CPU
+// if the machine does not expose its topology
+static size_t read_nodes(cpu_set_t *nodes, size_t max) {
+  size_t count = 0;
+  for (size_t n = 0; n < max; n++) {
+    char path[64], list[4096];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%zu/cpulist",
+             n);
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+      continue;
+    }
+    CPU_ZERO(&nodes[count]);
+    if (fgets(list, sizeof(list), f) != NULL) {
+      parse_cpu_list(list, &nodes[count]);
+    }
+    fclose(f);
+    count += CPU_COUNT(&nodes[count]) > 0;
+  }
+
+  if (count == 0) {
+    CPU_ZERO(&nodes[0]);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      CPU_SET(cpu, &nodes[0]);
+    }
+    count = 1;
+  }
+  return count;
+}
+
+// Orders the allowed CPUs for the job's placement policy
+// Compact fills one node before the next; scatter deals CPUs out of the
+// nodes in turn, so neighbouring workers sit on different nodes
+// Returns 0 on success, -1 on failure
+int mr_placement_init(struct mr_job *job) {
+  const struct mr_options *opts = &job->opts;
+  if (opts->placement == MR_PLACE_NONE) {
+    return 0;
+  }
+  if (opts->placement == MR_PLACE_LIST &&
+      (opts->cpus == NULL || opts->cpu_count == 0)) {
+    return -1;
+  }
+
+  struct mr_cpu_order *p = mr_arena_alloc(&job->arena, sizeof(*p));
+  if (p == NULL || sched_getaffinity(0, sizeof(p->allowed), &p->allowed) != 0) {
+    return -1;
+  }
+
+  if (opts->placement == MR_PLACE_LIST) {
+    p->cpus = (int *)opts->cpus;
+    p->count = opts->cpu_count;
+    job->cpu_order = p;
+    return 0;
+  }
+
+  cpu_set_t *nodes = mr_arena_alloc(&job->arena, MR_MAX_NODES * sizeof(*nodes));
+  p->cpus = mr_arena_alloc(&job->arena, CPU_SETSIZE * sizeof(int));
+  if (nodes == NULL || p->cpus == NULL) {
+    return -1;
+  }
+  size_t node_count = read_nodes(nodes, MR_MAX_NODES);
+  for (size_t n = 0; n < node_count; n++) {
+    CPU_AND(&nodes[n], &nodes[n], &p->allowed);
+  }
+
+  p->count = 0;
+  if (opts->placement == MR_PLACE_COMPACT) {
+    for (size_t n = 0; n < node_count; n++) {
+      for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &nodes[n])) {
+          p->cpus[p->count++] = cpu;
+        }
+      }
+    }
+  } else {
+    int next[MR_MAX_NODES] = {0};
+    for (bool added = true; added;) {
+      added = false;
+      for (size_t n = 0; n < node_count; n++) {
+        while (next[n] < CPU_SETSIZE && !CPU_ISSET(next[n], &nodes[n])) {
+          next[n]++;
+        }
+        if (next[n] < CPU_SETSIZE) {
+          p->cpus[p->count++] = next[n]++;
+          added = true;
+        }
+      }
+    }
+  }
+
+  // CPUs outside every node, e.g. with a partial sysfs, are not used
+  job->cpu_order = p->count > 0 ? p : NULL;
+  return 0;
+}
+
+// Pins the calling thread to its worker's CPU, before it allocates
+// anything, so first-touch puts the worker's memory on the local node
+// A CPU that cannot be used leaves the thread where it is
+void mr_place(struct mr_worker *w) {
+  const struct mr_cpu_order *p = w->job->cpu_order;
+  if (p == NULL) {
+    return;
+  }
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  int cpu = p->cpus[w->index % p->count];
+  if (cpu < 0 || cpu >= CPU_SETSIZE) {
+    return;
+  }
+  CPU_SET(cpu, &set);
+  if (pthread_getaffinity_np(pthread_self(), sizeof(saved_mask),
+                             &saved_mask) != 0) {
+    return;
+  }
+  w->pinned = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+// Records where the worker ran and gives the thread back its own mask, so
+// a pool thread is as free to move as before the job
+void mr_unplace(struct mr_worker *w) {
+  w->cpu_id = sched_getcpu();
+  if (w->pinned) {
+    pthread_setaffinity_np(pthread_self(), sizeof(saved_mask), &saved_mask);
+    w->pinned = false;
+  }
+}
@@ -0,0 +1,178 @@
+#include "framework.h"
+
+// Each kernel reads count numbers, stride bytes apart, straight from the
+// pairs or gathered values, two at a time in one SSE2 register
+
+static inline uint64_t load_u64(const char *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline double load_f64(const char *p) {
+  double v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint64_t sum_u64(const char *p, size_t stride, size_t count) {
+  uint64_t sum = 0;
+  size_t i = 0;
+#ifdef __SSE2__
+  __m128i acc0 = _mm_setzero_si128(), acc1 = _mm_setzero_si128();
+  for (; i + 4 <= count; i += 4, p += 4 * stride) {
+    __m128i a = _mm_unpacklo_epi64(
+        _mm_loadl_epi64((const __m128i *)p),
+        _mm_loadl_epi64((const __m128i *)(p + stride)));
+    __m128i b = _mm_unpacklo_epi64(
+        _mm_loadl_epi64((const __m128i *)(p + 2 * stride)),
+        _mm_loadl_epi64((const __m128i *)(p + 3 * stride)));
+    acc0 = _mm_add_epi64(acc0, a);
+    acc1 = _mm_add_epi64(acc1, b);
+  }
+  uint64_t lanes[2];
+  _mm_storeu_si128((__m128i *)lanes, _mm_add_epi64(acc0, acc1));
+  sum = lanes[0] + lanes[1];
+#endif
+  for (; i < count; i++, p += stride) {
+    sum += load_u64(p);
+  }
+  return sum;
+}
+
+// SSE2 has no 64-bit integer compare, so these stay scalar with two
+// independent chains
+static uint64_t min_u64(const char *p, size_t stride, size_t count) {
+  uint64_t a = load_u64(p), b = a;
+  size_t i = 1;
+  for (; i + 2 <= count; i += 2) {
+    uint64_t x = load_u64(p + i * stride), y = load_u64(p + (i + 1) * stride);
+    a = x < a ? x : a;
+    b = y < b ? y : b;
+  }
+  for (; i < count; i++) {
+    uint64_t x = load_u64(p + i * stride);
+    a = x < a ? x : a;
+  }
+  return a < b ? a : b;
+}
+
+static uint64_t max_u64(const char *p, size_t stride, size_t count) {
+  uint64_t a = load_u64(p), b = a;
+  size_t i = 1;
+  for (; i + 2 <= count; i += 2) {
+    uint64_t x = load_u64(p + i * stride), y = load_u64(p + (i + 1) * stride);
+    a = x > a ? x : a;
+    b = y > b ? y : b;
+  }
+  for (; i < count; i++) {
+    uint64_t x = load_u64(p + i * stride);
+    a = x > a ? x : a;
+  }
+  return a > b ? a : b;
+}
+
+enum f64_op { F64_SUM, F64_MIN, F64_MAX };
+
+// Sums keep four interleaved partial sums, so the last bits may differ
+// from adding the values in order
+static inline double fold_f64(enum f64_op op, const char *p, size_t stride,
+                              size_t count) {
+  double res = op == F64_SUM ? 0 : load_f64(p);
+  size_t i = 0;
+#ifdef __SSE2__
+  if (count >= 4) {
+    __m128d acc0 = _mm_set1_pd(res), acc1 = acc0;
+    if (op == F64_SUM) {
+      acc0 = acc1 = _mm_setzero_pd();
+    }
+    for (; i + 4 <= count; i += 4, p += 4 * stride) {
+      __m128d a = _mm_loadh_pd(_mm_load_sd((const double *)p),
+                               (const double *)(p + stride));
+      __m128d b = _mm_loadh_pd(_mm_load_sd((const double *)(p + 2 * stride)),
+                               (const double *)(p + 3 * stride));
+      if (op == F64_SUM) {
+        acc0 = _mm_add_pd(acc0, a);
+        acc1 = _mm_add_pd(acc1, b);
+      } else if (op == F64_MIN) {
+        acc0 = _mm_min_pd(acc0, a);
+        acc1 = _mm_min_pd(acc1, b);
+      } else {
+        acc0 = _mm_max_pd(acc0, a);
+        acc1 = _mm_max_pd(acc1, b);
+      }
+    }
+    double lanes[4];
+    _mm_storeu_pd(lanes, acc0);
+    _mm_storeu_pd(lanes + 2, acc1);
+    res = lanes[0];
+    for (size_t l = 1; l < 4; l++) {
+      res = op == F64_SUM   ? res + lanes[l]
+            : op == F64_MIN ? (lanes[l] < res ? lanes[l] : res)
+                            : (lanes[l] > res ? lanes[l] : res);
+    }
+  }
+#endif
+  for (; i < count; i++, p += stride) {
+    double v = load_f64(p);
+    res = op == F64_SUM   ? res + v
+          : op == F64_MIN ? (v < res ? v : res)
+                          : (v > res ? v : res);
+  }
+  return res;
+}
+
+// Reduces one key's values, the first at values and the others stride bytes
+// apart, with the job's aggregate and emits the result
+void mr_aggregate(struct mr_worker *self, const char *key, const char *values,
+                  size_t stride, size_t count) {
+  switch (self->job->opts.aggregate) {
+  case MR_AGG_COUNT:
+    mr_emit_f_u64(key, count);
+    break;
+  case MR_AGG_SUM_U64:
+    mr_emit_f_u64(key, sum_u64(values, stride, count));
+    break;
+  case MR_AGG_MIN_U64:
+    mr_emit_f_u64(key, min_u64(values, stride, count));
+    break;
+  case MR_AGG_MAX_U64:
+    mr_emit_f_u64(key, max_u64(values, stride, count));
+    break;
+  case MR_AGG_MEAN_U64:
+    mr_emit_f_f64(key, (double)sum_u64(values, stride, count) / count);
+    break;
+  case MR_AGG_SUM_F64:
+    mr_emit_f_f64(key, fold_f64(F64_SUM, values, stride, count));
+    break;
+  case MR_AGG_MIN_F64:
+    mr_emit_f_f64(key, fold_f64(F64_MIN, values, stride, count));
+    break;
+  case MR_AGG_MAX_F64:
+    mr_emit_f_f64(key, fold_f64(F64_MAX, values, stride, count));
+    break;
+  case MR_AGG_MEAN_F64:
+    mr_emit_f_f64(key, fold_f64(F64_SUM, values, stride, count) / count);
+    break;
+  case MR_AGG_NONE:
+    break;
+  }
+}
+
+// Kind of values maps must emit for an aggregate
+enum mr_values mr_aggregate_values(enum mr_aggregate agg) {
+  switch (agg) {
+  case MR_AGG_SUM_U64:
+  case MR_AGG_MIN_U64:
+  case MR_AGG_MAX_U64:
+  case MR_AGG_MEAN_U64:
+    return MR_VALUES_U64;
+  case MR_AGG_SUM_F64:
+  case MR_AGG_MIN_F64:
+  case MR_AGG_MAX_F64:
+  case MR_AGG_MEAN_F64:
+    return MR_VALUES_F64;
+  default:
+    return MR_VALUES_STRING;
+  }
+}
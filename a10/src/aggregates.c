@@ -0,0 +1,119 @@
+#include "interface.h"
+#include "tests.h"
+#include <stdlib.h>
+
+// Emits the record index, as a number
+void agg_map_u64(const struct mr_in_kv *in_kv) {
+  mr_emit_i_u64(in_kv->value, strtoull(in_kv->key, NULL, 10));
+}
+
+void agg_map_f64(const struct mr_in_kv *in_kv) {
+  mr_emit_i_f64(in_kv->value, strtoull(in_kv->key, NULL, 10) * 0.25);
+}
+
+static enum mr_aggregate agg_kind;
+
+// What the built-in aggregates compute, with a call per key
+void agg_reduce_u64(const struct mr_out_u64 *inter_kv) {
+  uint64_t sum = 0, min = inter_kv->value[0], max = min;
+  for (size_t i = 0; i < inter_kv->count; i++) {
+    uint64_t v = inter_kv->value[i];
+    sum += v;
+    min = v < min ? v : min;
+    max = v > max ? v : max;
+  }
+  if (agg_kind == MR_AGG_MEAN_U64) {
+    mr_emit_f_f64(inter_kv->key, (double)sum / inter_kv->count);
+  } else {
+    mr_emit_f_u64(inter_kv->key, agg_kind == MR_AGG_SUM_U64   ? sum
+                                 : agg_kind == MR_AGG_MIN_U64 ? min
+                                                              : max);
+  }
+}
+
+// Values are multiples of 0.25, summed exactly in any order
+void agg_reduce_f64(const struct mr_out_f64 *inter_kv) {
+  double sum = 0, min = inter_kv->value[0], max = min;
+  for (size_t i = 0; i < inter_kv->count; i++) {
+    double v = inter_kv->value[i];
+    sum += v;
+    min = v < min ? v : min;
+    max = v > max ? v : max;
+  }
+  double res = agg_kind == MR_AGG_SUM_F64   ? sum
+               : agg_kind == MR_AGG_MIN_F64 ? min
+               : agg_kind == MR_AGG_MAX_F64 ? max
+                                            : sum / inter_kv->count;
+  mr_emit_f_f64(inter_kv->key, res);
+}
+
+bool aggregates(void) {
+  struct mr_input agg_input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  struct mr_output agg_output = {NULL, 0}, ref_output = {NULL, 0};
+  struct mr_options opts = {0}, ref_opts = {0};
+
+  bool res = true;
+  for (size_t m = 1; m <= MAX_THREADS; m *= 4) {
+    for (size_t r = 1; r <= MAX_THREADS; r *= 4) {
+      // Word count from string or number values
+      opts = (struct mr_options){.aggregate = MR_AGG_COUNT};
+      res = res &&
+            mr_exec_ext(&agg_input, amr_map, m, NULL, r, &agg_output,
+                        &opts) == 0 &&
+            agg_output.count == 57 && amr_cmp(&agg_output) == 0;
+      free_output(&agg_output);
+      opts.aggregate = MR_AGG_SUM_U64;
+      res = res &&
+            mr_exec_ext(&agg_input, typ_map, m, NULL, r, &agg_output,
+                        &opts) == 0 &&
+            agg_output.count == 57 && amr_cmp(&agg_output) == 0;
+      free_output(&agg_output);
+
+      for (agg_kind = MR_AGG_SUM_U64; agg_kind <= MR_AGG_MEAN_F64;
+           agg_kind++) {
+        bool f64 = agg_kind >= MR_AGG_SUM_F64;
+        opts = (struct mr_options){.aggregate = agg_kind};
+        ref_opts = (struct mr_options){
+            .reduce_u64 = f64 ? NULL : agg_reduce_u64,
+            .reduce_f64 = f64 ? agg_reduce_f64 : NULL};
+        // The spilled path hands values over in its own layout
+        if (m == MAX_THREADS) {
+          opts.memory_budget = 1024;
+        }
+
+        void (*map)(const struct mr_in_kv *) = f64 ? agg_map_f64 : agg_map_u64;
+        res = res &&
+              mr_exec_ext(&agg_input, map, m, NULL, r, &agg_output, &opts) ==
+                  0 &&
+              mr_exec_ext(&agg_input, map, m, NULL, r, &ref_output,
+                          &ref_opts) == 0 &&
+              spl_cmp(&agg_output, &ref_output) == 0;
+        free_output(&agg_output);
+        free_output(&ref_output);
+      }
+    }
+  }
+
+  // One reduce per job
+  opts = (struct mr_options){.aggregate = MR_AGG_COUNT,
+                             .reduce_u64 = agg_reduce_u64};
+  res = res && mr_exec_ext(&agg_input, amr_map, 1, NULL, 1, &agg_output,
+                           &opts) == -1;
+
+  // Option values past the end of their enums are rejected
+  struct mr_options bad[] = {
+      {.aggregate = MR_AGG_MEAN_F64 + 1},
+      {.partition = MR_PARTITION_SAMPLE + 1},
+      {.grouping = MR_GROUP_RADIX + 1},
+      {.layout = MR_LAYOUT_PAIRS + 1},
+      {.placement = MR_PLACE_LIST + 1},
+      {.partition = -1},
+  };
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    res = res && mr_exec_ext(&agg_input, amr_map, 1, amr_reduce, 1,
+                             &agg_output, &bad[i]) == -1;
+  }
+  TEST(res, 0);
+
+  return res;
+}
@@ -0,0 +1,87 @@
+#include "framework.h"
+#include <stdint.h>
+#include <sys/mman.h>
+
+#define MR_CHUNK_MIN (64 * 1024)
+#define MR_CHUNK_MAX (64 * 1024 * 1024)
+
+// Header at the start of every mapped chunk
+struct mr_chunk {
+  struct mr_chunk *prev;
+  size_t size; // mapped bytes, header included
+  size_t used; // bytes handed out, header included
+} __attribute__((aligned(MR_CACHE_LINE)));
+
+static size_t align_up(size_t n) {
+  return (n + MR_CACHE_LINE - 1) & ~(size_t)(MR_CACHE_LINE - 1);
+}
+
+// Returns size bytes aligned to a cache line, or NULL if out of memory
+// Allocation is a pointer bump; a new chunk is mapped only when full
+void *mr_arena_alloc(struct mr_arena *arena, size_t size) {
+  struct mr_chunk *chunk = arena->head;
+  size = align_up(size == 0 ? 1 : size);
+
+  if (chunk == NULL || chunk->size - chunk->used < size) {
+    size_t want = arena->next_size < MR_CHUNK_MIN ? MR_CHUNK_MIN
+                                                  : arena->next_size;
+    if (want < size + sizeof(struct mr_chunk)) {
+      want = align_up(size + sizeof(struct mr_chunk));
+    }
+
+    void *mem = mmap(NULL, want, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+      return NULL;
+    }
+    chunk = mem;
+    chunk->prev = arena->head;
+    chunk->size = want;
+    chunk->used = sizeof(struct mr_chunk);
+    arena->head = chunk;
+    arena->maps++;
+    arena->next_size = want * 2 > MR_CHUNK_MAX ? MR_CHUNK_MAX : want * 2;
+  }
+
+  void *ptr = (char *)chunk + chunk->used;
+  chunk->used += size;
+  return ptr;
+}
+
+struct mr_arena_mark mr_arena_mark(const struct mr_arena *arena) {
+  return (struct mr_arena_mark){arena->head,
+                                arena->head ? arena->head->used : 0};
+}
+
+// Frees everything allocated after the mark
+void mr_arena_reset(struct mr_arena *arena, struct mr_arena_mark mark) {
+  while (arena->head != mark.chunk) {
+    struct mr_chunk *prev = arena->head->prev;
+    munmap(arena->head, arena->head->size);
+    arena->head = prev;
+  }
+  if (arena->head != NULL) {
+    arena->head->used = mark.used;
+  }
+}
+
+// Unmaps every chunk of the arena
+void mr_arena_release(struct mr_arena *arena) {
+  mr_arena_reset(arena, (struct mr_arena_mark){NULL, 0});
+  arena->next_size = 0;
+}
+
+// Moves every chunk of src into dst, leaving src empty
+void mr_arena_append(struct mr_arena *dst, struct mr_arena *src) {
+  if (src->head == NULL) {
+    return;
+  }
+  struct mr_chunk *oldest = src->head;
+  while (oldest->prev != NULL) {
+    oldest = oldest->prev;
+  }
+  oldest->prev = dst->head;
+  dst->head = src->head;
+  dst->maps += src->maps;
+  *src = (struct mr_arena){0};
+}
@@ -0,0 +1,59 @@
+#include "interface.h"
+#include "tests.h"
+
+#define ASY_JOBS 8
+
+bool async_jobs(void) {
+  struct mr_input asy_input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  struct mr_output asy_outputs[ASY_JOBS], ref_output = {NULL, 0};
+  struct mr_handle *handles[ASY_JOBS];
+  struct mr_pool *pool = mr_pool_create(4);
+
+  static const size_t threads[] = {1, 4, 16, 2};
+
+  // Word count and value-order jobs in flight together, on their own
+  // threads and then sharing a pool
+  bool res = pool != NULL;
+  for (size_t p = 0; p < 2 && res; p++) {
+    struct mr_options opts = {.pool = p == 1 ? pool : NULL};
+    for (size_t j = 0; j < ASY_JOBS; j++) {
+      size_t n = threads[j % 4];
+      handles[j] = j % 2 == 0 ? mr_submit(&asy_input, amr_map, n, amr_reduce,
+                                          n + 1, &opts)
+                              : mr_submit(&asy_input, spl_map, n, spl_reduce,
+                                          n + 1, &opts);
+    }
+    for (size_t j = 0; j < ASY_JOBS; j++) {
+      size_t n = threads[j % 4];
+      if (handles[j] == NULL || mr_wait(handles[j], &asy_outputs[j]) != 0) {
+        res = false;
+        continue;
+      }
+      if (j % 2 == 0) {
+        res = res && asy_outputs[j].count == 57 &&
+              amr_cmp(&asy_outputs[j]) == 0;
+      } else {
+        res = res &&
+              mr_exec(&asy_input, spl_map, n, spl_reduce, n + 1,
+                      &ref_output) == 0 &&
+              spl_cmp(&asy_outputs[j], &ref_output) == 0;
+        free_output(&ref_output);
+      }
+      free_output(&asy_outputs[j]);
+    }
+  }
+
+  // A job whose output is not wanted is still waited for and freed, with
+  // malloc'd and with arena output
+  for (size_t a = 0; a < 2; a++) {
+    struct mr_options opts = {.arena_output = a == 1};
+    struct mr_handle *h =
+        mr_submit(&asy_input, amr_map, 4, amr_reduce, 4, &opts);
+    res = res && h != NULL && mr_wait(h, NULL) == 0;
+  }
+  res = res && mr_wait(NULL, &ref_output) == -1;
+  mr_pool_destroy(pool);
+  TEST(res, 0);
+
+  return res;
+}
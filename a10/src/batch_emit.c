@@ -0,0 +1,69 @@
+#include "interface.h"
+#include "tests.h"
+#include <stdio.h>
+
+#define MOD 8
+
+// Emits two records in each three with one batch call, the third alone
+void bem_map(const struct mr_in_kv *kv_lst, size_t count) {
+  for (size_t i = 0; i < count; i += 3) {
+    const char *keys[2], *values[2];
+    size_t n = count - i < 2 ? count - i : 2;
+    for (size_t j = 0; j < n; j++) {
+      keys[j] = kv_lst[i + j].key;
+      values[j] = kv_lst[i + j].value;
+    }
+    mr_emit_i_batch(keys, values, n);
+    if (i + 2 < count) {
+      mr_emit_i(kv_lst[i + 2].key, kv_lst[i + 2].value);
+    }
+  }
+}
+
+// Emits every word of the batch in one call
+void bem_count_map(const struct mr_in_kv *kv_lst, size_t count) {
+  const char *keys[MAX_DATA_SIZE], *values[MAX_DATA_SIZE];
+  for (size_t i = 0; i < count; i++) {
+    keys[i] = kv_lst[i].value;
+    values[i] = "1";
+  }
+  mr_emit_i_batch(keys, values, count);
+}
+
+bool batch_emit(void) {
+  sr_call_count = 0;
+
+  for (size_t i = 0; i < MAX_DATA_SIZE; i++) {
+    snprintf(sr_in_kv_lst[i].key, MAX_KEY_SIZE, "%zu", i % MOD);
+    snprintf(sr_in_kv_lst[i].value, MAX_VALUE_SIZE, "%zu", i);
+  }
+
+  struct mr_input bem_input = {sr_in_kv_lst, MAX_DATA_SIZE};
+  struct mr_output bem_output = {NULL, 0};
+  struct mr_options opts = {.map_batch = bem_map};
+
+  // Same as single_reduce
+  bool res = mr_exec_ext(&bem_input, NULL, 1, sr_reduce, 1, &bem_output,
+                         &opts) == 0 &&
+             sr_call_count == MOD && sr_cmp() == 0;
+  free_output(&bem_output);
+
+  bem_input.kv_lst = ex_in_kv_lst;
+  opts.map_batch = bem_count_map;
+  for (size_t i = 0; i < 3; i++) {
+    opts.partition = i == 0 ? MR_PARTITION_RANGE : MR_PARTITION_HASH;
+    opts.memory_budget = i == 2 ? 1024 : 0;
+    for (size_t m = 1; m <= MAX_THREADS; m *= 4) {
+      for (size_t r = 1; r <= MAX_THREADS; r *= 4) {
+        res = res &&
+              mr_exec_ext(&bem_input, NULL, m, amr_reduce, r, &bem_output,
+                          &opts) == 0 &&
+              bem_output.count == 57 && amr_cmp(&bem_output) == 0;
+        free_output(&bem_output);
+      }
+    }
+  }
+  TEST(res, 0);
+
+  return res;
+}
@@ -0,0 +1,49 @@
+#include "interface.h"
+#include "tests.h"
+#include <stdlib.h>
+
+void bat_pin_map(const struct mr_in_kv *kv_lst, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    pin_map(&kv_lst[i]);
+  }
+}
+
+void bat_map(const struct mr_in_kv *kv_lst, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    mr_emit_i(kv_lst[i].value, "1");
+  }
+}
+
+bool batch_map(void) {
+  struct mr_input bat_input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  struct mr_output bat_output = {NULL, 0};
+  struct mr_options opts = {.map_batch = bat_pin_map};
+
+  // Each mapper still sees exactly its contiguous slice
+  bool res = true;
+  for (size_t n = 2; n <= MAX_THREADS; n *= 2) {
+    partitions_reset();
+    res = res &&
+          mr_exec_ext(&bat_input, NULL, n, pin_reduce, 1, &bat_output,
+                      &opts) == 0 &&
+          partition_cmp(ex_in_kv_lst, n) == 0 && !too_many_partitions;
+    free_output(&bat_output);
+  }
+
+  opts.map_batch = bat_map;
+  for (size_t m = 1; m <= MAX_THREADS; m *= 4) {
+    for (size_t r = 1; r <= MAX_THREADS; r *= 4) {
+      res = res &&
+            mr_exec_ext(&bat_input, NULL, m, amr_reduce, r, &bat_output,
+                        &opts) == 0 &&
+            bat_output.count == 57 && amr_cmp(&bat_output) == 0;
+      free_output(&bat_output);
+    }
+  }
+
+  res = res && mr_exec_ext(&bat_input, NULL, 1, amr_reduce, 1, &bat_output,
+                           NULL) == -1;
+  TEST(res, 0);
+
+  return res;
+}
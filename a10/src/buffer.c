@@ -0,0 +1,243 @@
+#include "framework.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MR_SEG_MIN 64
+#define MR_SEG_MAX 65536
+
+__thread struct mr_worker *mr_self = NULL;
+
+static inline void pair_set(struct mr_pair *pair, const char *key,
+                            const char *value) {
+  mr_copy_field(pair->key, key, MAX_KEY_SIZE);
+  mr_copy_field(pair->value, value, MAX_VALUE_SIZE);
+}
+
+static struct mr_seg *seg_new(struct mr_arena *arena, size_t cap) {
+  struct mr_seg *seg =
+      mr_arena_alloc(arena, sizeof(*seg) + cap * sizeof(struct mr_pair));
+  if (seg == NULL) {
+    return NULL;
+  }
+  seg->next = NULL;
+  seg->count = 0;
+  seg->cap = cap;
+  return seg;
+}
+
+// Returns the last segment, with room for at least one more pair, or NULL
+// if out of memory
+static inline struct mr_seg *buffer_tail(struct mr_arena *arena,
+                                         struct mr_buffer *buf) {
+  struct mr_seg *tail = buf->tail;
+
+  if (tail == NULL || tail->count == tail->cap) {
+    size_t cap = tail == NULL ? MR_SEG_MIN : tail->cap * 2;
+    struct mr_seg *seg = seg_new(arena, cap > MR_SEG_MAX ? MR_SEG_MAX : cap);
+    if (seg == NULL) {
+      return NULL;
+    }
+    if (tail == NULL) {
+      buf->head = seg;
+    } else {
+      tail->next = seg;
+    }
+    buf->tail = tail = seg;
+  }
+  return tail;
+}
+
+int mr_buffer_push(struct mr_arena *arena, struct mr_buffer *buf,
+                   const struct mr_pair *pair) {
+  struct mr_seg *tail = buffer_tail(arena, buf);
+  if (tail == NULL) {
+    return -1;
+  }
+
+  tail->pairs[tail->count++] = *pair;
+  buf->count++;
+  return 0;
+}
+
+void mr_buffer_copy(const struct mr_buffer *buf, struct mr_pair *dst) {
+  for (struct mr_seg *seg = buf->head; seg != NULL; seg = seg->next) {
+    memcpy(dst, seg->pairs, seg->count * sizeof(struct mr_pair));
+    dst += seg->count;
+  }
+}
+
+// Empties the buffer, its segments stay in the arena until the job ends
+void mr_buffer_clear(struct mr_buffer *buf) {
+  buf->head = buf->tail = NULL;
+  buf->count = 0;
+}
+
+// Counts pairs just buffered by the mapper
+// Past its share of the memory budget the mapper spills what it buffered
+static inline int emitted(struct mr_worker *self, size_t count) {
+  size_t limit = self->job->spill_pairs;
+  self->buffered += count;
+  if (!self->combining) {
+    self->emitted += count;
+    if (limit > 0 && self->buffered >= limit && mr_spill(self) != 0) {
+      self->failed = true;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// Appends to the calling mapper's private buffer, no locks or atomics
+// With hash partitioning the pair goes straight to its reducer's bucket
+static inline int emit_pair(struct mr_worker *self,
+                            const struct mr_pair *pair) {
+  struct mr_buffer *buf = self->parts;
+  if (self->part_count > 1) {
+    buf += mr_key_hash(pair->key) % self->part_count;
+  }
+  if (mr_buffer_push(&self->arena, buf, pair) != 0) {
+    self->failed = true;
+    return -1;
+  }
+  return emitted(self, 1);
+}
+
+// The calling mapper, if its job's values are of the given kind
+static inline struct mr_worker *mapper_of(enum mr_values values) {
+  struct mr_worker *self = mr_self;
+  if (self == NULL || self->role != MR_MAPPER ||
+      self->job->values != values) {
+    return NULL;
+  }
+  return self;
+}
+
+int mr_emit_i(const char *key, const char *value) {
+  struct mr_worker *self = mapper_of(MR_VALUES_STRING);
+  if (self == NULL || key == NULL || value == NULL) {
+    return -1;
+  }
+
+  struct mr_pair pair;
+  pair_set(&pair, key, value);
+  return emit_pair(self, &pair);
+}
+
+// Checks the pairs once, then fills whole buffer segments at a time
+int mr_emit_i_batch(const char *const *keys, const char *const *values,
+                    size_t count) {
+  struct mr_worker *self = mapper_of(MR_VALUES_STRING);
+  if (self == NULL || (count > 0 && (keys == NULL || values == NULL))) {
+    return -1;
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (keys[i] == NULL || values[i] == NULL) {
+      return -1;
+    }
+  }
+
+  struct mr_buffer *buf = self->parts;
+  if (self->part_count > 1) {
+    for (size_t i = 0; i < count; i++) {
+      struct mr_pair pair;
+      pair_set(&pair, keys[i], values[i]);
+      if (mr_buffer_push(&self->arena,
+                         &buf[mr_key_hash(pair.key) % self->part_count],
+                         &pair) != 0) {
+        self->failed = true;
+        return -1;
+      }
+    }
+    return emitted(self, count);
+  }
+
+  for (size_t i = 0; i < count;) {
+    struct mr_seg *tail = buffer_tail(&self->arena, buf);
+    if (tail == NULL) {
+      self->failed = true;
+      return -1;
+    }
+
+    size_t n = tail->cap - tail->count;
+    n = n < count - i ? n : count - i;
+    struct mr_pair *dst = &tail->pairs[tail->count];
+    for (size_t j = 0; j < n; j++) {
+      pair_set(&dst[j], keys[i + j], values[i + j]);
+    }
+    tail->count += n;
+    buf->count += n;
+    i += n;
+  }
+  return emitted(self, count);
+}
+
+// Numbers go into the value bytes as they are, zero-padded like strings
+static inline void number_set(struct mr_pair *pair, const char *key,
+                              const void *number) {
+  mr_copy_field(pair->key, key, MAX_KEY_SIZE);
+  memcpy(pair->value, number, sizeof(uint64_t));
+  memset(pair->value + sizeof(uint64_t), 0,
+         MAX_VALUE_SIZE - sizeof(uint64_t));
+}
+
+int mr_emit_i_u64(const char *key, uint64_t value) {
+  struct mr_worker *self = mapper_of(MR_VALUES_U64);
+  if (self == NULL || key == NULL) {
+    return -1;
+  }
+
+  struct mr_pair pair;
+  number_set(&pair, key, &value);
+  return emit_pair(self, &pair);
+}
+
+int mr_emit_i_f64(const char *key, double value) {
+  struct mr_worker *self = mapper_of(MR_VALUES_F64);
+  if (self == NULL || key == NULL) {
+    return -1;
+  }
+
+  struct mr_pair pair;
+  number_set(&pair, key, &value);
+  return emit_pair(self, &pair);
+}
+
+int mr_emit_f(const char *key, const char *value) {
+  struct mr_worker *self = mr_self;
+
+  if (self == NULL || self->role != MR_REDUCER || key == NULL ||
+      value == NULL) {
+    return -1;
+  }
+  if (self->direct) {
+    return mr_direct_emit(self, key, value);
+  }
+
+  struct mr_pair pair;
+  pair_set(&pair, key, value);
+  struct mr_buffer *buf = self->reducing_hot ? &self->hot_out : &self->out;
+  if (mr_buffer_push(&self->arena, buf, &pair) != 0) {
+    self->failed = true;
+    return -1;
+  }
+  self->emitted++;
+  return 0;
+}
+
+int mr_emit_f_u64(const char *key, uint64_t value) {
+  // Digits are written from the end, then the string is moved to the front
+  char str[MAX_VALUE_SIZE + 8];
+  char *p = str + sizeof(str) - 1;
+  *p = '\0';
+  do {
+    *--p = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+  return mr_emit_f(key, p);
+}
+
+int mr_emit_f_f64(const char *key, double value) {
+  char str[MAX_VALUE_SIZE];
+  snprintf(str, sizeof(str), "%.8g", value);
+  return mr_emit_f(key, str);
+}
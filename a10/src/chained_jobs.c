@@ -0,0 +1,125 @@
+#include "interface.h"
+#include "tests.h"
+#include <stdio.h>
+
+#define CHN_STAGES 3
+
+// Turns a count back into a key, so the next stage counts the counts
+void chn_invert(const struct mr_in_kv *in_kv) {
+  mr_emit_i(in_kv->value, in_kv->key);
+}
+
+void chn_count(const struct mr_out_kv *inter_kv) {
+  char cnt_str[MAX_VALUE_SIZE];
+  snprintf(cnt_str, MAX_VALUE_SIZE, "%zu", inter_kv->count);
+  mr_emit_f(inter_kv->key, cnt_str);
+}
+
+// Runs the stages as separate mr_exec_ext calls, each output turned back
+// into input records for the next one
+static int chn_separate(const struct mr_stage *stages, size_t count, size_t m,
+                        struct mr_output *output) {
+  static struct mr_in_kv kv_lst[MAX_DATA_SIZE];
+  struct mr_input input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  for (size_t k = 0; k < count; k++) {
+    if (mr_exec_ext(&input, stages[k].map, m, stages[k].reduce,
+                    stages[k].reducer_count, output, NULL) != 0) {
+      return -1;
+    }
+    if (k + 1 == count) {
+      return 0;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < output->count; i++) {
+      for (size_t j = 0; j < output->kv_lst[i].count; j++, n++) {
+        snprintf(kv_lst[n].key, MAX_KEY_SIZE, "%s", output->kv_lst[i].key);
+        snprintf(kv_lst[n].value, MAX_VALUE_SIZE, "%s",
+                 output->kv_lst[i].value[j]);
+      }
+    }
+    free_output(output);
+    input = (struct mr_input){kv_lst, n};
+    m = stages[k].reducer_count;
+  }
+  return 0;
+}
+
+bool chained_jobs(void) {
+  struct mr_input chn_input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  struct mr_output chn_output = {NULL, 0}, ref_output = {NULL, 0};
+  enum mr_partition modes[] = {MR_PARTITION_RANGE, MR_PARTITION_SAMPLE,
+                               MR_PARTITION_HASH};
+
+  bool res = true;
+  for (size_t p = 0; p < 3; p++) {
+    for (size_t m = 1; m <= MAX_THREADS; m *= 4) {
+      for (size_t r = 1; r <= MAX_THREADS; r *= 4) {
+        struct mr_options opts = {.partition = modes[p]};
+
+        // Word count, then how many words have each count, then how many
+        // counts are shared by that many words
+        struct mr_stage counts[CHN_STAGES] = {
+            {amr_map, amr_reduce, r, &opts},
+            {chn_invert, chn_count, r + 1, &opts},
+            {chn_invert, chn_count, m, &opts},
+        };
+        res = res &&
+              mr_pipeline(&chn_input, m, counts, CHN_STAGES, &chn_output) ==
+                  0 &&
+              chn_separate(counts, CHN_STAGES, m, &ref_output) == 0 &&
+              spl_cmp(&chn_output, &ref_output) == 0;
+        free_output(&chn_output);
+        free_output(&ref_output);
+
+        // Values reach each stage in the order of the previous output when
+        // keys are split by range
+        if (modes[p] != MR_PARTITION_HASH) {
+          struct mr_stage order[CHN_STAGES] = {
+              {spl_map, spl_reduce, r, &opts},
+              {col_map, spl_reduce, r + 1, &opts},
+              {spl_map, spl_reduce, m, &opts},
+          };
+          res = res &&
+                mr_pipeline(&chn_input, m, order, CHN_STAGES, &chn_output) ==
+                    0 &&
+                chn_separate(order, CHN_STAGES, m, &ref_output) == 0 &&
+                spl_cmp(&chn_output, &ref_output) == 0;
+          free_output(&chn_output);
+          free_output(&ref_output);
+        }
+      }
+    }
+  }
+
+  // Stats per stage, each stage mapped by as many mappers as the one
+  // before had reducers; only the last stage writes its output in place
+  struct mr_stats stats[CHN_STAGES];
+  struct mr_options opts[CHN_STAGES];
+  struct mr_stage counts[CHN_STAGES];
+  for (size_t k = 0; k < CHN_STAGES; k++) {
+    opts[k] = (struct mr_options){.stats = &stats[k], .direct_output = true};
+    counts[k] = (struct mr_stage){chn_invert, chn_count, 3 + k, &opts[k]};
+  }
+  counts[0].map = amr_map;
+  counts[0].reduce = amr_reduce;
+  res = res &&
+        mr_pipeline(&chn_input, 2, counts, CHN_STAGES, &chn_output) == 0 &&
+        chn_separate(counts, CHN_STAGES, 2, &ref_output) == 0 &&
+        spl_cmp(&chn_output, &ref_output) == 0 &&
+        stats[0].mapper_count == 2 && stats[1].mapper_count == 3 &&
+        stats[2].mapper_count == 4 && stats[2].reducer_count == 5 &&
+        stats[1].pairs_emitted == 57;
+  mr_release_output(&chn_output);
+  free_output(&ref_output);
+
+  // No stages, a stage without reducers or no output all fail
+  counts[1].reducer_count = 0;
+  res = res &&
+        mr_pipeline(&chn_input, 2, counts, CHN_STAGES, &chn_output) == -1 &&
+        chn_output.kv_lst == NULL && chn_output.count == 0 &&
+        mr_pipeline(&chn_input, 2, counts, 0, &chn_output) == -1 &&
+        mr_pipeline(&chn_input, 2, counts, 1, NULL) == -1;
+  TEST(res, 0);
+
+  return res;
+}
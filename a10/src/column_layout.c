@@ -0,0 +1,74 @@
+#include "interface.h"
+#include "tests.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Emits the record index, so reduce sees values in a checkable order
+void col_map(const struct mr_in_kv *in_kv) {
+  mr_emit_i(in_kv->value, in_kv->key);
+}
+
+// Hashes the values in the order reduce gets them
+void col_reduce(const struct mr_out_kv *inter_kv) {
+  unsigned long hash = 0;
+  for (size_t i = 0; i < inter_kv->count; i++) {
+    hash = hash * 31 + strtoul(inter_kv->value[i], NULL, 10);
+  }
+  char value[MAX_VALUE_SIZE];
+  snprintf(value, MAX_VALUE_SIZE, "%lu", hash % 1000000007);
+  mr_emit_f(inter_kv->key, value);
+}
+
+bool column_layout(void) {
+  struct mr_input col_input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  struct mr_output col_output = {NULL, 0}, ref_output = {NULL, 0};
+  enum mr_partition partitions[] = {MR_PARTITION_RANGE, MR_PARTITION_HASH,
+                                    MR_PARTITION_SAMPLE};
+
+  bool res = true;
+  for (size_t p = 0; p < 3; p++) {
+    for (size_t m = 1; m <= MAX_THREADS; m *= 4) {
+      for (size_t r = 1; r <= MAX_THREADS; r *= 4) {
+        struct mr_options opts = {.partition = partitions[p]};
+        struct mr_options ref_opts = {.partition = partitions[p],
+                                      .layout = MR_LAYOUT_PAIRS};
+
+        // Same values in the same order as from the pairs
+        res = res &&
+              mr_exec_ext(&col_input, col_map, m, col_reduce, r, &col_output,
+                          &opts) == 0 &&
+              mr_exec_ext(&col_input, col_map, m, col_reduce, r, &ref_output,
+                          &ref_opts) == 0 &&
+              col_output.count == 57 && spl_cmp(&col_output, &ref_output) == 0;
+        free_output(&col_output);
+        free_output(&ref_output);
+
+        opts.direct_output = true;
+        res = res &&
+              mr_exec_ext(&col_input, amr_map, m, amr_reduce, r, &col_output,
+                          &opts) == 0 &&
+              col_output.count == 57 && amr_cmp(&col_output) == 0;
+        mr_release_output(&col_output);
+
+        opts.direct_output = false;
+        opts.aggregate = MR_AGG_SUM_U64;
+        res = res &&
+              mr_exec_ext(&col_input, typ_map, m, NULL, r, &col_output,
+                          &opts) == 0 &&
+              col_output.count == 57 && amr_cmp(&col_output) == 0;
+        free_output(&col_output);
+
+        opts.aggregate = MR_AGG_NONE;
+        opts.reduce_u64 = typ_reduce;
+        res = res &&
+              mr_exec_ext(&col_input, typ_map, m, NULL, r, &col_output,
+                          &opts) == 0 &&
+              col_output.count == 57 && amr_cmp(&col_output) == 0;
+        free_output(&col_output);
+      }
+    }
+  }
+  TEST(res, 0);
+
+  return res;
+}
@@ -0,0 +1,55 @@
+#include "interface.h"
+#include "tests.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void cmb_map(const struct mr_in_kv *in_kv) { mr_emit_i(in_kv->value, "1"); }
+
+size_t cmb_sum(const struct mr_out_kv *inter_kv) {
+  size_t sum = 0;
+  for (size_t i = 0; i < inter_kv->count; i++) {
+    sum += strtoull(inter_kv->value[i], NULL, 10);
+  }
+  return sum;
+}
+
+void cmb_combine(const struct mr_out_kv *inter_kv) {
+  char sum_str[MAX_VALUE_SIZE];
+  snprintf(sum_str, MAX_VALUE_SIZE, "%zu", cmb_sum(inter_kv));
+  mr_emit_i(inter_kv->key, sum_str);
+}
+
+void cmb_reduce(const struct mr_out_kv *inter_kv) {
+  char sum_str[MAX_VALUE_SIZE];
+  snprintf(sum_str, MAX_VALUE_SIZE, "%zu", cmb_sum(inter_kv));
+  mr_emit_f(inter_kv->key, sum_str);
+}
+
+bool combine_map_reduce(void) {
+  struct mr_input cmb_input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  struct mr_output cmb_output;
+
+  bool res = true;
+  for (size_t i = 0; i < 2; i++) {
+    struct mr_stats stats;
+    struct mr_options opts = {
+        .partition = i == 0 ? MR_PARTITION_RANGE : MR_PARTITION_HASH,
+        .combine = cmb_combine,
+        .stats = &stats,
+    };
+
+    for (size_t m = 1; m <= MAX_THREADS; m *= 4) {
+      res = res &&
+            mr_exec_ext(&cmb_input, cmb_map, m, cmb_reduce, 8, &cmb_output,
+                        &opts) == 0 &&
+            cmb_output.count == 57 && amr_cmp(&cmb_output) == 0 &&
+            stats.pairs_emitted == MAX_DATA_SIZE &&
+            stats.pairs_shuffled <= 57 * m;
+      free_output(&cmb_output);
+    }
+  }
+  TEST(res, 0);
+
+  return res;
+}
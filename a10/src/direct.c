@@ -0,0 +1,184 @@
+#include "framework.h"
+
+#define MR_SLAB_VALUES 4096
+
+// Gives every reducer one kv_lst slot per group it will reduce, each
+// reducer's slots following the previous reducer's
+// Returns 0 on success, -1 on failure
+int mr_direct_layout(struct mr_job *job) {
+  size_t total = 0, r_count = job->reducer_count;
+  for (size_t r = 0; r < r_count; r++) {
+    struct mr_worker *w = &job->reducers[r];
+    if (job->opts.partition == MR_PARTITION_RANGE) {
+      size_t n = job->group_count;
+      w->slot_count = (r + 1) * n / r_count - r * n / r_count;
+    } else {
+      w->slot_count = w->group_count;
+    }
+    total += w->slot_count;
+  }
+
+  struct mr_output_head *head = mr_arena_alloc(
+      &job->direct_out, sizeof(*head) + total * sizeof(struct mr_out_kv));
+  if (head == NULL) {
+    return -1;
+  }
+  struct mr_out_kv *kv_lst = (struct mr_out_kv *)(head + 1);
+  for (size_t r = 0; r < r_count; r++) {
+    job->reducers[r].slots = kv_lst;
+    job->reducers[r].direct = true;
+    kv_lst += job->reducers[r].slot_count;
+  }
+  return 0;
+}
+
+// Returns room for one more value of kv, the last key written, or NULL if
+// out of memory
+// A key's values must stay contiguous, so those already written move along
+// when the slab runs out; slabs grow with the key to bound that copying
+static char (*slab_take(struct mr_worker *self,
+                        struct mr_out_kv *kv))[MAX_VALUE_SIZE] {
+  if (self->slab_free == 0) {
+    size_t cap = 2 * (kv->count + 1);
+    cap = cap < MR_SLAB_VALUES ? MR_SLAB_VALUES : cap;
+    char(*slab)[MAX_VALUE_SIZE] =
+        mr_arena_alloc(&self->values, cap * MAX_VALUE_SIZE);
+    if (slab == NULL) {
+      return NULL;
+    }
+    if (kv->count > 0) {
+      memcpy(slab, kv->value, kv->count * MAX_VALUE_SIZE);
+      kv->value = slab;
+    }
+    self->slab = slab + kv->count;
+    self->slab_free = cap - kv->count;
+  }
+  if (kv->count == 0) {
+    kv->value = self->slab;
+  }
+  self->slab_free--;
+  return self->slab++;
+}
+
+// Hands what the reducer wrote in place over to its usual output buffer
+// Returns 0 on success, -1 on failure
+static int direct_unwind(struct mr_worker *self) {
+  struct mr_pair pair;
+  self->direct = false;
+  for (size_t s = 0; s < self->slot_used; s++) {
+    const struct mr_out_kv *kv = &self->slots[s];
+    memcpy(pair.key, kv->key, MAX_KEY_SIZE);
+    for (size_t i = 0; i < kv->count; i++) {
+      memcpy(pair.value, kv->value[i], MAX_VALUE_SIZE);
+      if (mr_buffer_push(&self->arena, &self->out, &pair) != 0) {
+        return -1;
+      }
+    }
+  }
+  self->slot_used = 0;
+  self->slab_free = 0;
+  self->final_count = 0;
+  // Its maps count stays for workers_free, as reducers may unwind at once
+  mr_arena_release(&self->values);
+  return 0;
+}
+
+// Writes a final pair into the reducer's kv_lst slots and value slabs
+// A key below the last one, or more keys than slots, would need merging,
+// so the reducer then goes back to buffering its pairs
+// Returns 0 on success, -1 on failure
+int mr_direct_emit(struct mr_worker *self, const char *key,
+                   const char *value) {
+  char padded[MAX_KEY_SIZE];
+  mr_copy_field(padded, key, MAX_KEY_SIZE);
+
+  struct mr_out_kv *kv =
+      self->slot_used > 0 ? &self->slots[self->slot_used - 1] : NULL;
+  int order = kv == NULL ? 1 : mr_key_cmp(padded, kv->key);
+  if (order < 0 || (order > 0 && self->slot_used == self->slot_count)) {
+    if (direct_unwind(self) != 0) {
+      self->failed = true;
+      return -1;
+    }
+    return mr_emit_f(key, value);
+  }
+
+  if (order > 0) {
+    kv = &self->slots[self->slot_used++];
+    memcpy(kv->key, padded, MAX_KEY_SIZE);
+    kv->count = 0;
+  }
+  char(*dst)[MAX_VALUE_SIZE] = slab_take(self, kv);
+  if (dst == NULL) {
+    self->failed = true;
+    return -1;
+  }
+  mr_copy_field(*dst, value, MAX_VALUE_SIZE);
+  kv->count++;
+  self->final_count++;
+  self->emitted++;
+  return 0;
+}
+
+// Whether every reducer kept writing in place, each one's keys all sorting
+// before the next one's
+static bool direct_ordered(const struct mr_job *job) {
+  const struct mr_out_kv *last = NULL;
+  for (size_t r = 0; r < job->reducer_count; r++) {
+    const struct mr_worker *w = &job->reducers[r];
+    if (!w->direct) {
+      return false;
+    }
+    if (w->slot_used == 0) {
+      continue;
+    }
+    if (last != NULL && mr_key_cmp(last->key, w->slots[0].key) >= 0) {
+      return false;
+    }
+    last = &w->slots[w->slot_used - 1];
+  }
+  return true;
+}
+
+// Turns the slots the reducers wrote into the final output
+// Reducers that emitted fewer keys than they had groups leave gaps, closed
+// by moving the later entries down; values never move. If the reducers'
+// keys are out of order they are merged as with arena_output instead
+// Returns 0 on success, -1 on failure
+int mr_direct_assemble(struct mr_job *job, struct mr_output *output) {
+  if (!direct_ordered(job)) {
+    for (size_t r = 0; r < job->reducer_count; r++) {
+      struct mr_worker *w = &job->reducers[r];
+      if (w->direct &&
+          (direct_unwind(w) != 0 || mr_prepare_final(w) != 0)) {
+        return -1;
+      }
+    }
+    job->maps += job->direct_out.maps;
+    mr_arena_release(&job->direct_out);
+    return mr_assemble(job, output);
+  }
+
+  struct mr_out_kv *kv_lst = job->reducers[0].slots;
+  size_t count = 0;
+  for (size_t r = 0; r < job->reducer_count; r++) {
+    struct mr_worker *w = &job->reducers[r];
+    if (w->slots != kv_lst + count) {
+      memmove(kv_lst + count, w->slots, w->slot_used * sizeof(*kv_lst));
+    }
+    count += w->slot_used;
+    mr_arena_append(&job->direct_out, &w->values);
+  }
+
+  if (count == 0) {
+    job->maps += job->direct_out.maps;
+    mr_arena_release(&job->direct_out);
+    return 0;
+  }
+  job->output_allocs += job->direct_out.maps;
+  ((struct mr_output_head *)kv_lst - 1)->arena = job->direct_out;
+  job->direct_out = (struct mr_arena){0};
+  output->kv_lst = kv_lst;
+  output->count = count;
+  return 0;
+}
@@ -0,0 +1,76 @@
+#include "interface.h"
+#include "tests.h"
+#include <string.h>
+
+// Drops keys starting with a vowel, leaving gaps between reducers' outputs
+void dir_filter(const struct mr_out_kv *inter_kv) {
+  if (strchr("aeiou", inter_kv->key[0]) == NULL) {
+    spl_reduce(inter_kv);
+  }
+}
+
+// Also emits a key sorting before everything else, which cannot be
+// written in place
+void dir_total(const struct mr_out_kv *inter_kv) {
+  mr_emit_f("!", inter_kv->key);
+  spl_reduce(inter_kv);
+}
+
+// Pairs the reducers say they emitted, against the values in output
+static bool dir_emitted(const struct mr_thread_stats *threads, size_t m,
+                        size_t r, const struct mr_output *output) {
+  size_t emitted = 0, values = 0;
+  for (size_t i = 0; i < r; i++) {
+    emitted += threads[m + i].emitted;
+  }
+  for (size_t i = 0; i < output->count; i++) {
+    values += output->kv_lst[i].count;
+  }
+  return emitted == values;
+}
+
+bool direct_output(void) {
+  struct mr_input dir_input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  struct mr_output dir_output = {NULL, 0}, ref_output = {NULL, 0};
+  enum mr_partition modes[] = {MR_PARTITION_RANGE, MR_PARTITION_SAMPLE,
+                               MR_PARTITION_HASH};
+  void (*reduces[])(const struct mr_out_kv *) = {spl_reduce, dir_filter,
+                                                 dir_total};
+
+  struct mr_thread_stats threads[2 * MAX_THREADS];
+
+  bool res = true;
+  for (size_t i = 0; i < 3; i++) {
+    struct mr_options opts = {.partition = modes[i],
+                              .direct_output = true,
+                              .thread_stats = threads};
+    struct mr_options ref_opts = {.partition = modes[i]};
+
+    for (size_t m = 1; m <= MAX_THREADS; m *= 4) {
+      for (size_t r = 1; r <= MAX_THREADS; r *= 2) {
+        res = res &&
+              mr_exec_ext(&dir_input, amr_map, m, amr_reduce, r, &dir_output,
+                          &opts) == 0 &&
+              dir_output.count == 57 && amr_cmp(&dir_output) == 0 &&
+              dir_emitted(threads, m, r, &dir_output);
+        mr_release_output(&dir_output);
+
+        for (size_t f = 0; f < 3; f++) {
+          res = res &&
+                mr_exec_ext(&dir_input, spl_map, m, reduces[f], r,
+                            &dir_output, &opts) == 0;
+          res = res &&
+                mr_exec_ext(&dir_input, spl_map, m, reduces[f], r, &ref_output,
+                            &ref_opts) == 0 &&
+                spl_cmp(&dir_output, &ref_output) == 0 &&
+                dir_emitted(threads, m, r, &ref_output);
+          mr_release_output(&dir_output);
+          free_output(&ref_output);
+        }
+      }
+    }
+  }
+  TEST(res, 0);
+
+  return res;
+}
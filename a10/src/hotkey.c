@@ -0,0 +1,103 @@
+#include "framework.h"
+#include <string.h>
+
+// Moves keys with more than half a reducer's fair share of the pairs out
+// of the groups reducers split by range, into the job's hot groups
+// Returns 0 on success, -1 on failure
+int mr_split_hot(struct mr_job *job) {
+  size_t r_count = job->reducer_count, hot = 0;
+  job->hot = NULL;
+  job->hot_count = 0;
+  if (job->opts.merge == NULL || r_count < 2) {
+    return 0;
+  }
+
+  for (size_t g = 0; g < job->group_count; g++) {
+    const struct mr_group *group = &job->groups[g];
+    hot += (group->end - group->begin) * 2 * r_count > job->pair_count;
+  }
+  if (hot == 0) {
+    return 0;
+  }
+
+  job->hot = mr_arena_alloc(&job->arena, hot * sizeof(struct mr_group));
+  if (job->hot == NULL) {
+    return -1;
+  }
+
+  // Cold groups keep their order, so reducers still get sorted key ranges
+  size_t cold = 0;
+  for (size_t g = 0; g < job->group_count; g++) {
+    struct mr_group group = job->groups[g];
+    if ((group.end - group.begin) * 2 * r_count > job->pair_count) {
+      job->hot[job->hot_count++] = group;
+    } else {
+      job->groups[cold++] = group;
+    }
+  }
+  job->group_count = cold;
+  return 0;
+}
+
+// Reduce is called on every reducer's part of the hot keys, so merge gets
+// each key's partial results from all of them, in reducer order
+// Merged pairs join reducer 0's output
+// Returns 0 on success, -1 on failure
+int mr_merge_hot(struct mr_job *job) {
+  size_t r_count = job->reducer_count, total = 0;
+  for (size_t r = 0; r < r_count; r++) {
+    total += job->reducers[r].hot_out.count;
+  }
+  if (total == 0) {
+    return 0;
+  }
+
+  struct mr_worker *self = &job->reducers[0];
+  struct mr_arena_mark mark = mr_arena_mark(&job->arena);
+  struct mr_pair *pairs = mr_arena_alloc(&job->arena, total * sizeof(*pairs));
+  struct mr_pair *merged = mr_arena_alloc(&job->arena, total * sizeof(*pairs));
+  struct mr_run *runs = mr_arena_alloc(&job->arena, r_count * sizeof(*runs));
+  if (pairs == NULL || merged == NULL || runs == NULL) {
+    return -1;
+  }
+
+  // Reduce may emit other keys than it was given, so sort each part first
+  struct mr_pair *dst = pairs;
+  for (size_t r = 0; r < r_count; r++) {
+    const struct mr_buffer *buf = &job->reducers[r].hot_out;
+    mr_buffer_copy(buf, dst);
+    if (mr_sort_pairs(&job->arena, dst, buf->count, job->opts.grouping) != 0) {
+      return -1;
+    }
+    runs[r] = (struct mr_run){dst, dst + buf->count, r};
+    dst += buf->count;
+  }
+  mr_merge_runs(runs, r_count, merged);
+
+  struct mr_group *groups;
+  size_t group_count;
+  if (mr_find_groups(&job->arena, merged, total, &groups, &group_count) != 0) {
+    return -1;
+  }
+
+  mr_self = self;
+  for (size_t g = 0; g < group_count && !self->failed; g++) {
+    size_t n = groups[g].end - groups[g].begin;
+    struct mr_out_kv kv = {.value = mr_scratch(self, n), .count = n};
+    if (kv.value == NULL) {
+      break;
+    }
+    memcpy(kv.key, merged[groups[g].begin].key, MAX_KEY_SIZE);
+    for (size_t i = 0; i < n; i++) {
+      memcpy(kv.value[i], merged[groups[g].begin + i].value, MAX_VALUE_SIZE);
+    }
+    job->opts.merge(&kv);
+  }
+  mr_self = NULL;
+
+  mr_arena_reset(&job->arena, mark);
+  if (self->failed) {
+    return -1;
+  }
+  return mr_prepare_final(self);
+}
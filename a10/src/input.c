@@ -0,0 +1,54 @@
+#include "interface.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int mr_input_map(const char *path, struct mr_input *input) {
+  if (path == NULL || input == NULL) {
+    return -1;
+  }
+  input->kv_lst = NULL;
+  input->count = 0;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size % sizeof(struct mr_in_kv) != 0) {
+    close(fd);
+    return -1;
+  }
+  if (st.st_size == 0) {
+    close(fd);
+    return 0;
+  }
+
+  // The mapping outlives the descriptor; pages come from the page cache,
+  // so repeated jobs over the same file share them
+  void *mem = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  int err = errno;
+  close(fd);
+  if (mem == MAP_FAILED) {
+    errno = err;
+    return -1;
+  }
+  // Mappers walk contiguous slices front to back
+  madvise(mem, st.st_size, MADV_SEQUENTIAL);
+
+  input->kv_lst = mem;
+  input->count = st.st_size / sizeof(struct mr_in_kv);
+  return 0;
+}
+
+void mr_input_unmap(struct mr_input *input) {
+  if (input == NULL || input->kv_lst == NULL) {
+    return;
+  }
+  munmap(input->kv_lst, input->count * sizeof(struct mr_in_kv));
+  input->kv_lst = NULL;
+  input->count = 0;
+}
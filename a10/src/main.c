@@ -1,9 +1,34 @@
 #include "tests.h"
+#include <string.h>
 
 int main(int argc, char *argv[]) {
   if (single_map() && single_reduce() && single_map_reduce() &&
       number_of_mappers() && number_of_reducers() && partition_input() &&
       partition_intermediate() && full_map_reduce())
     TEST(true, 5);
+
+  // Extensions beyond mr_exec, checked but not graded
+  combine_map_reduce();
+  pool_calls();
+  spill_map_reduce();
+  mapped_input();
+  phase_stats();
+  placement();
+  split_reduce();
+  sample_partition();
+  direct_output();
+  typed_reduce();
+  aggregates();
+  batch_map();
+  batch_emit();
+  column_layout();
+  mapper_budget();
+  streaming();
+  async_jobs();
+  chained_jobs();
+
+  if (argc > 1 && strcmp(argv[1], "--stats") == 0) {
+    print_phase_stats();
+  }
   return 0;
 }
@@ -0,0 +1,54 @@
+#include "interface.h"
+#include "tests.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Writes count packed records to a new temporary file
+// Returns the file's descriptor and path, or -1
+int mpi_write(char *path, const struct mr_in_kv *kv_lst, size_t count,
+              size_t extra) {
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    return -1;
+  }
+  size_t size = count * sizeof(struct mr_in_kv) + extra;
+  if (write(fd, kv_lst, size) != (ssize_t)size) {
+    close(fd);
+    unlink(path);
+    return -1;
+  }
+  return fd;
+}
+
+bool mapped_input(void) {
+  char path[] = "/tmp/mr_input_XXXXXX";
+  int fd = mpi_write(path, ex_in_kv_lst, MAX_DATA_SIZE, 0);
+  struct mr_input mpi_input;
+  struct mr_output mpi_output = {NULL, 0};
+
+  bool res = fd >= 0 && mr_input_map(path, &mpi_input) == 0 &&
+             mpi_input.count == MAX_DATA_SIZE;
+  for (size_t m = 1; res && m <= MAX_THREADS; m *= 4) {
+    res = mr_exec(&mpi_input, amr_map, m, amr_reduce, 8, &mpi_output) == 0 &&
+          mpi_output.count == 57 && amr_cmp(&mpi_output) == 0;
+    free_output(&mpi_output);
+  }
+  if (fd >= 0) {
+    mr_input_unmap(&mpi_input);
+    close(fd);
+    unlink(path);
+  }
+
+  // A trailing partial record means the file is not a packed input
+  char bad_path[] = "/tmp/mr_input_XXXXXX";
+  fd = mpi_write(bad_path, ex_in_kv_lst, 2, 1);
+  res = res && fd >= 0 && mr_input_map(bad_path, &mpi_input) == -1;
+  if (fd >= 0) {
+    close(fd);
+    unlink(bad_path);
+  }
+  TEST(res, 0);
+
+  return res;
+}
@@ -0,0 +1,63 @@
+#include "interface.h"
+#include "tests.h"
+
+bool mapper_budget(void) {
+  struct mr_input mb_input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  struct mr_output mb_output = {NULL, 0}, mem_output = {NULL, 0};
+  enum mr_partition partitions[] = {MR_PARTITION_RANGE, MR_PARTITION_HASH,
+                                    MR_PARTITION_SAMPLE};
+
+  bool res = true;
+  for (size_t p = 0; p < 3; p++) {
+    for (size_t m = 1; m <= MAX_THREADS; m *= 4) {
+      for (size_t r = 1; r <= MAX_THREADS; r *= 4) {
+        struct mr_stats stats;
+        struct mr_options opts = {.partition = partitions[p],
+                                  .stats = &stats,
+                                  .mapper_budget = 4096};
+
+        // A small cap flushes many runs early, a large one none
+        res = res &&
+              mr_exec_ext(&mb_input, amr_map, m, amr_reduce, r, &mb_output,
+                          &opts) == 0 &&
+              mb_output.count == 57 && amr_cmp(&mb_output) == 0 &&
+              stats.spill_runs > 0 && stats.pairs_emitted == MAX_DATA_SIZE;
+        free_output(&mb_output);
+        opts.mapper_budget = 1 << 30;
+        res = res &&
+              mr_exec_ext(&mb_input, amr_map, m, amr_reduce, r, &mb_output,
+                          &opts) == 0 &&
+              mb_output.count == 57 && amr_cmp(&mb_output) == 0 &&
+              stats.spill_runs == 0;
+        free_output(&mb_output);
+
+        // Values still reach reduce in emit order
+        opts.mapper_budget = 1;
+        res = res &&
+              mr_exec_ext(&mb_input, spl_map, m, spl_reduce, r, &mb_output,
+                          &opts) == 0 &&
+              mr_exec(&mb_input, spl_map, m, spl_reduce, r, &mem_output) ==
+                  0 &&
+              spl_cmp(&mb_output, &mem_output) == 0;
+        free_output(&mb_output);
+        free_output(&mem_output);
+
+        // The combiner runs on every flush, fanning out as without a budget
+        opts.mapper_budget = 4096;
+        opts.combine = cmb_combine;
+        struct mr_options mem_opts = {.combine = cmb_combine};
+        res = res &&
+              mr_exec_ext(&mb_input, cmb_map, m, cmb_reduce, r, &mb_output,
+                          &opts) == 0 &&
+              mr_exec_ext(&mb_input, cmb_map, m, cmb_reduce, r, &mem_output,
+                          &mem_opts) == 0 &&
+              spl_cmp(&mb_output, &mem_output) == 0 && stats.spill_runs > 0;
+        free_output(&mb_output);
+        free_output(&mem_output);
+      }
+    }
+  }
+  TEST(res, 0);
+
+  return res;
+}
@@ -0,0 +1,670 @@
+#include "framework.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MR_MAP_BATCH 4096
+
+// Runs fn on one thread per worker and waits for all of them
+// Uses the job's pool if it has one, fresh threads otherwise
+// Returns 0 on success, -1 if a thread could not be started
+int mr_run_workers(struct mr_job *job, struct mr_worker *workers, size_t count,
+                   void *(*fn)(void *)) {
+  if (job->opts.pool != NULL) {
+    return mr_pool_run(job->opts.pool, workers, count, fn);
+  }
+
+  size_t started = 0;
+  for (; started < count; started++) {
+    if (pthread_create(&workers[started].thread, NULL, fn,
+                       &workers[started]) != 0) {
+      break;
+    }
+  }
+  for (size_t i = 0; i < started; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
+  return started == count ? 0 : -1;
+}
+
+// Returns the worker's value array grown to hold count values, keeping
+// those already in it, or NULL if out of memory
+char (*mr_scratch(struct mr_worker *self, size_t count))[MAX_VALUE_SIZE] {
+  if (count > self->scratch_cap) {
+    size_t cap = count > 2 * self->scratch_cap ? count : 2 * self->scratch_cap;
+    char(*scratch)[MAX_VALUE_SIZE] =
+        mr_arena_alloc(&self->arena, cap * MAX_VALUE_SIZE);
+    if (scratch == NULL) {
+      self->failed = true;
+      return NULL;
+    }
+    if (self->scratch_cap > 0) {
+      memcpy(scratch, self->scratch, self->scratch_cap * MAX_VALUE_SIZE);
+    }
+    self->scratch = scratch;
+    self->scratch_cap = cap;
+  }
+  return self->scratch;
+}
+
+// Returns the worker's packed number array grown to hold count numbers, or
+// NULL if out of memory; unlike mr_scratch it is refilled for every key
+static uint64_t *number_scratch(struct mr_worker *self, size_t count) {
+  if (count > self->number_cap) {
+    size_t cap = count > 2 * self->number_cap ? count : 2 * self->number_cap;
+    uint64_t *numbers = mr_arena_alloc(&self->arena, cap * sizeof(uint64_t));
+    if (numbers == NULL) {
+      self->failed = true;
+      return NULL;
+    }
+    self->numbers = numbers;
+    self->number_cap = cap;
+  }
+  return self->numbers;
+}
+
+// Calls the job's typed reduce on one key, numbers being the key's values
+// packed by the caller
+static void reduce_numbers(const struct mr_job *job, const char *key,
+                           const uint64_t *numbers, size_t count) {
+  if (job->values == MR_VALUES_U64) {
+    struct mr_out_u64 kv = {.value = numbers, .count = count};
+    memcpy(kv.key, key, MAX_KEY_SIZE);
+    job->opts.reduce_u64(&kv);
+  } else {
+    struct mr_out_f64 kv = {.value = (const double *)numbers, .count = count};
+    memcpy(kv.key, key, MAX_KEY_SIZE);
+    job->opts.reduce_f64(&kv);
+  }
+}
+
+// Calls the job's reduce on one key whose values were gathered as strings,
+// packing them first for a typed reduce
+void mr_reduce_kv(struct mr_worker *self, const struct mr_out_kv *kv) {
+  struct mr_job *job = self->job;
+  if (job->opts.aggregate != MR_AGG_NONE) {
+    mr_aggregate(self, kv->key, kv->value[0], MAX_VALUE_SIZE, kv->count);
+    return;
+  }
+  if (job->values == MR_VALUES_STRING) {
+    job->reduce(kv);
+    return;
+  }
+
+  uint64_t *numbers = number_scratch(self, kv->count);
+  if (numbers == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < kv->count; i++) {
+    memcpy(&numbers[i], kv->value[i], sizeof(uint64_t));
+  }
+  reduce_numbers(job, kv->key, numbers, kv->count);
+}
+
+// Calls fn for each group, with the group's values in one array
+static void reduce_groups(struct mr_worker *self, const struct mr_pair *pairs,
+                          const struct mr_group *groups, size_t count,
+                          void (*fn)(const struct mr_out_kv *)) {
+  for (size_t g = 0; g < count; g++) {
+    const struct mr_group *group = &groups[g];
+    size_t n = group->end - group->begin;
+
+    struct mr_out_kv kv = {.value = mr_scratch(self, n), .count = n};
+    if (kv.value == NULL) {
+      return;
+    }
+    memcpy(kv.key, pairs[group->begin].key, MAX_KEY_SIZE);
+    for (size_t i = 0; i < n; i++) {
+      memcpy(kv.value[i], pairs[group->begin + i].value, MAX_VALUE_SIZE);
+    }
+    fn(&kv);
+  }
+}
+
+// Reduces each group with the job's reduce, typed ones getting the numbers
+// packed straight from the pairs, aggregates reading them in place
+static void reduce_job_groups(struct mr_worker *self,
+                              const struct mr_pair *pairs,
+                              const struct mr_group *groups, size_t count) {
+  struct mr_job *job = self->job;
+  if (job->opts.aggregate != MR_AGG_NONE) {
+    for (size_t g = 0; g < count; g++) {
+      const struct mr_pair *group = pairs + groups[g].begin;
+      mr_aggregate(self, group->key, group->value, sizeof(struct mr_pair),
+                   groups[g].end - groups[g].begin);
+    }
+    return;
+  }
+  if (job->values == MR_VALUES_STRING) {
+    reduce_groups(self, pairs, groups, count, job->reduce);
+    return;
+  }
+
+  for (size_t g = 0; g < count; g++) {
+    const struct mr_pair *group = pairs + groups[g].begin;
+    size_t n = groups[g].end - groups[g].begin;
+
+    uint64_t *numbers = number_scratch(self, n);
+    if (numbers == NULL) {
+      return;
+    }
+    for (size_t i = 0; i < n; i++) {
+      memcpy(&numbers[i], group[i].value, sizeof(uint64_t));
+    }
+    reduce_numbers(job, group->key, numbers, n);
+  }
+}
+
+// Reduces each key of the columns, reduce seeing its values where they lie
+// and typed reduces getting them packed
+static void reduce_columns(struct mr_worker *self,
+                           const struct mr_columns *cols) {
+  struct mr_job *job = self->job;
+  for (size_t k = 0; k < cols->count && !self->failed; k++) {
+    size_t begin = cols->offsets[k], n = cols->offsets[k + 1] - begin;
+    if (job->opts.aggregate != MR_AGG_NONE) {
+      mr_aggregate(self, cols->keys[k], cols->values[begin], MAX_VALUE_SIZE, n);
+    } else if (job->values == MR_VALUES_STRING) {
+      struct mr_out_kv kv = {.value = cols->values + begin, .count = n};
+      memcpy(kv.key, cols->keys[k], MAX_KEY_SIZE);
+      job->reduce(&kv);
+    } else {
+      uint64_t *numbers = number_scratch(self, n);
+      if (numbers == NULL) {
+        return;
+      }
+      for (size_t i = 0; i < n; i++) {
+        memcpy(&numbers[i], cols->values[begin + i], sizeof(uint64_t));
+      }
+      reduce_numbers(job, cols->keys[k], numbers, n);
+    }
+  }
+}
+
+// Replaces the mapper's output with what combine emits for each key
+// Returns 0 on success, -1 on failure
+int mr_combine_local(struct mr_worker *self) {
+  size_t total = 0;
+  for (size_t i = 0; i < self->part_count; i++) {
+    total += self->parts[i].count;
+  }
+  if (total == 0) {
+    return 0;
+  }
+
+  struct mr_pair *pairs = mr_arena_alloc(&self->arena, total * sizeof(*pairs));
+  if (pairs == NULL) {
+    return -1;
+  }
+  struct mr_pair *dst = pairs;
+  for (size_t i = 0; i < self->part_count; i++) {
+    mr_buffer_copy(&self->parts[i], dst);
+    dst += self->parts[i].count;
+    mr_buffer_clear(&self->parts[i]);
+  }
+
+  const struct mr_options *opts = &self->job->opts;
+  struct mr_group *groups = NULL;
+  size_t group_count = 0;
+  if (mr_sort_pairs(&self->arena, pairs, total, opts->grouping) != 0 ||
+      mr_find_groups(&self->arena, pairs, total, &groups, &group_count) != 0) {
+    return -1;
+  }
+
+  // May run in the middle of map when spilling, so restore the caller's view
+  struct mr_worker *caller = mr_self;
+  mr_self = self;
+  self->combining = true;
+  reduce_groups(self, pairs, groups, group_count, opts->combine);
+  self->combining = false;
+  mr_self = caller;
+  return self->failed ? -1 : 0;
+}
+
+// Maps the mapper's slice of the input, then sorts it into a run
+static void map_slice(struct mr_worker *self) {
+  struct mr_job *job = self->job;
+  const struct mr_in_kv *kv_lst;
+  size_t count;
+  if (job->slices != NULL) {
+    kv_lst = job->slices[self->index].kv_lst;
+    count = job->slices[self->index].count;
+  } else {
+    size_t n = job->input->count, m = job->mapper_count;
+    size_t begin = self->index * n / m, end = (self->index + 1) * n / m;
+    kv_lst = job->input->kv_lst + begin;
+    count = end - begin;
+  }
+
+  self->records = count;
+  self->spill_mark = mr_arena_mark(&self->arena);
+  mr_self = self;
+  if (job->opts.map_batch != NULL) {
+    // Batches split the mapper's own slice, in input order
+    for (size_t i = 0; i < count && !self->failed; i += MR_MAP_BATCH) {
+      size_t n = count - i < MR_MAP_BATCH ? count - i : MR_MAP_BATCH;
+      job->opts.map_batch(&kv_lst[i], n);
+    }
+  } else {
+    for (size_t i = 0; i < count && !self->failed; i++) {
+      job->map(&kv_lst[i]);
+    }
+  }
+  mr_self = NULL;
+
+  if (self->failed) {
+    return;
+  }
+  if (job->spill_pairs > 0) {
+    self->failed = mr_spill_finish(self) != 0;
+    return;
+  }
+  if (job->opts.combine != NULL && mr_combine_local(self) != 0) {
+    self->failed = true;
+    return;
+  }
+  for (size_t i = 0; i < self->part_count; i++) {
+    self->shuffled += self->parts[i].count;
+  }
+
+  // Hashed buckets are left for their reducers to gather and sort
+  if (job->opts.partition == MR_PARTITION_HASH) {
+    return;
+  }
+
+  self->run_count = self->out.count;
+  if (self->run_count > 0) {
+    self->run =
+        mr_arena_alloc(&self->arena, self->run_count * sizeof(struct mr_pair));
+    if (self->run == NULL) {
+      self->failed = true;
+    } else {
+      mr_buffer_copy(&self->out, self->run);
+      self->failed |= mr_sort_pairs(&self->arena, self->run, self->run_count,
+                                    job->opts.grouping) != 0;
+    }
+  }
+  mr_buffer_clear(&self->out);
+}
+
+// Allocated by the mapper itself, so the buckets are local to its node
+static int alloc_parts(struct mr_worker *self) {
+  size_t count = self->job->reducer_count;
+  struct mr_buffer *parts =
+      mr_arena_alloc(&self->arena, count * sizeof(struct mr_buffer));
+  if (parts == NULL) {
+    return -1;
+  }
+  memset(parts, 0, count * sizeof(struct mr_buffer));
+  self->parts = parts;
+  self->part_count = count;
+  return 0;
+}
+
+static void *map_worker(void *arg) {
+  struct mr_worker *self = arg;
+  mr_place(self);
+  mr_worker_begin(self);
+  if (self->job->opts.partition == MR_PARTITION_HASH &&
+      alloc_parts(self) != 0) {
+    self->failed = true;
+  } else {
+    map_slice(self);
+  }
+  mr_worker_end(self);
+  mr_unplace(self);
+  return NULL;
+}
+
+// Reduces a contiguous range of the sorted groups, or the reducer's own
+// bucket or sampled range, gathered from the mappers
+static void *reduce_worker(void *arg) {
+  struct mr_worker *self = arg;
+  struct mr_job *job = self->job;
+
+  mr_place(self);
+  mr_worker_begin(self);
+
+  mr_self = self;
+  if (job->spill_pairs > 0) {
+    mr_spill_reduce(self);
+  } else if (job->opts.partition != MR_PARTITION_RANGE) {
+    // Writing in place, the range was gathered before the slots were laid out
+    int res = job->opts.partition == MR_PARTITION_HASH
+                  ? mr_gather_bucket(job, self)
+              : job->direct ? 0
+                            : mr_gather_range(job, self);
+    if (res != 0) {
+      self->failed = true;
+    } else if (job->opts.layout == MR_LAYOUT_PAIRS) {
+      self->records = self->group_count;
+      reduce_job_groups(self, self->run, self->groups, self->group_count);
+    } else {
+      self->records = self->group_count;
+      reduce_columns(self, &self->cols);
+    }
+  } else {
+    size_t n = job->group_count, r = job->reducer_count;
+    size_t begin = self->index * n / r, end = (self->index + 1) * n / r;
+    self->records = end - begin;
+    if (job->opts.layout == MR_LAYOUT_PAIRS) {
+      reduce_job_groups(self, job->pairs, job->groups + begin, end - begin);
+    } else {
+      // Offsets stay relative to the job's values
+      struct mr_columns slice = {job->cols.keys + begin, job->cols.values,
+                                 job->cols.offsets + begin, end - begin};
+      reduce_columns(self, &slice);
+    }
+
+    // Every reducer takes an equal slice of each hot key's values
+    self->reducing_hot = true;
+    for (size_t h = 0; h < job->hot_count && !self->failed; h++) {
+      size_t count = job->hot[h].end - job->hot[h].begin;
+      struct mr_group slice = {job->hot[h].begin + self->index * count / r,
+                               job->hot[h].begin +
+                                   (self->index + 1) * count / r};
+      if (slice.begin < slice.end) {
+        reduce_groups(self, job->pairs, &slice, 1, job->reduce);
+      }
+    }
+    self->reducing_hot = false;
+  }
+  mr_self = NULL;
+
+  if (!self->failed && !self->direct && mr_prepare_final(self) != 0) {
+    self->failed = true;
+  }
+  mr_worker_end(self);
+  mr_unplace(self);
+  return NULL;
+}
+
+// Gathers a reducer's sampled range, so its group count is known before
+// any reducer writes its output in place
+static void *gather_worker(void *arg) {
+  struct mr_worker *self = arg;
+  mr_place(self);
+  mr_worker_begin(self);
+  if (mr_gather_range(self->job, self) != 0) {
+    self->failed = true;
+  }
+  mr_worker_end(self);
+  mr_unplace(self);
+  return NULL;
+}
+
+// Pairs each mapper may buffer before spilling, 0 for no limit
+// A mapper's own budget also holds the sorted copy and the sort buffer a
+// spill allocates, so it buffers a third of what fits
+static size_t spill_pairs(const struct mr_options *opts, size_t mapper_count) {
+  size_t pair = sizeof(struct mr_pair), limit = 0;
+  if (opts->memory_budget > 0) {
+    size_t share = pair * mapper_count;
+    limit = (opts->memory_budget + share - 1) / share;
+  }
+  if (opts->mapper_budget > 0) {
+    size_t own = opts->mapper_budget / (3 * pair);
+    own = own > 0 ? own : 1;
+    limit = limit == 0 || own < limit ? own : limit;
+  }
+  return limit;
+}
+
+static struct mr_worker *workers_new(struct mr_job *job, enum mr_role role,
+                                     size_t count) {
+  struct mr_worker *workers =
+      mr_arena_alloc(&job->arena, count * sizeof(struct mr_worker));
+  if (workers == NULL) {
+    return NULL;
+  }
+  memset(workers, 0, count * sizeof(struct mr_worker));
+  for (size_t i = 0; i < count; i++) {
+    workers[i].job = job;
+    workers[i].role = role;
+    workers[i].index = i;
+    workers[i].parts = &workers[i].out;
+    workers[i].part_count = 1;
+    workers[i].spill_fd = -1;
+  }
+
+  return workers;
+}
+
+// Releases the workers' arenas and spill files, the array itself belongs
+// to the job arena
+static void workers_free(struct mr_worker *workers, size_t count) {
+  if (workers == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    workers[i].job->maps += workers[i].arena.maps + workers[i].values.maps;
+    mr_arena_release(&workers[i].arena);
+    mr_arena_release(&workers[i].values);
+    if (workers[i].spill_fd >= 0) {
+      close(workers[i].spill_fd);
+    }
+    free(workers[i].spill_runs);
+  }
+}
+
+static bool workers_failed(const struct mr_worker *workers, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (workers[i].failed) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Checks a job's functions, thread counts and options and fills them in
+// Returns 0 on success, -1 if the job cannot run
+int mr_job_init(struct mr_job *job, void (*map)(const struct mr_in_kv *),
+                size_t mapper_count, void (*reduce)(const struct mr_out_kv *),
+                size_t reducer_count, const struct mr_options *options) {
+  *job = (struct mr_job){
+      .map = map,
+      .reduce = reduce,
+      .mapper_count = mapper_count,
+      .reducer_count = reducer_count,
+  };
+  if (mapper_count == 0 || reducer_count == 0) {
+    return -1;
+  }
+  if (options != NULL) {
+    job->opts = *options;
+  }
+  // Enums come from the caller, and an unknown one would skip every case
+  const struct mr_options *o = &job->opts;
+  if ((unsigned)o->partition > MR_PARTITION_SAMPLE ||
+      (unsigned)o->grouping > MR_GROUP_RADIX ||
+      (unsigned)o->layout > MR_LAYOUT_PAIRS ||
+      (unsigned)o->placement > MR_PLACE_LIST ||
+      (unsigned)o->aggregate > MR_AGG_MEAN_F64) {
+    return -1;
+  }
+  if (map == NULL && job->opts.map_batch == NULL) {
+    return -1;
+  }
+  // Numbers only ever reach a typed reduce or an aggregate
+  size_t reduces = (job->opts.reduce_u64 != NULL) +
+                   (job->opts.reduce_f64 != NULL) +
+                   (job->opts.aggregate != MR_AGG_NONE);
+  if (reduces > 0) {
+    if (reduces > 1 || job->opts.combine != NULL || job->opts.merge != NULL) {
+      return -1;
+    }
+    job->values = job->opts.reduce_u64 != NULL   ? MR_VALUES_U64
+                  : job->opts.reduce_f64 != NULL ? MR_VALUES_F64
+                                  : mr_aggregate_values(job->opts.aggregate);
+  } else if (reduce == NULL) {
+    return -1;
+  }
+  job->spill_pairs = spill_pairs(&job->opts, mapper_count);
+  // Hot keys are only found in the global merge, as slices of the pairs
+  if (job->opts.merge != NULL) {
+    if (job->opts.partition != MR_PARTITION_RANGE || job->spill_pairs > 0) {
+      return -1;
+    }
+    job->opts.layout = MR_LAYOUT_PAIRS;
+  }
+  // Output written in place is released like arena output, and also built
+  // that way where reducers cannot write in place
+  job->opts.arena_output |= job->opts.direct_output;
+  job->direct = job->opts.direct_output &&
+                job->opts.partition != MR_PARTITION_HASH &&
+                job->spill_pairs == 0 && job->opts.merge == NULL;
+  return 0;
+}
+
+// Runs the mappers over job->input or their slices, each leaving its sorted
+// run or buckets, and adds their counters to stats
+// Returns 0 on success, -1 on failure
+int mr_map_phase(struct mr_job *job, struct mr_stats *stats) {
+  size_t mapper_count = job->mapper_count;
+  job->mappers = workers_new(job, MR_MAPPER, mapper_count);
+  if (job->mappers == NULL ||
+      mr_run_workers(job, job->mappers, mapper_count, map_worker) != 0 ||
+      workers_failed(job->mappers, mapper_count)) {
+    return -1;
+  }
+  mr_lap(job, stats, MR_PHASE_MAP);
+  mr_collect_workers(job, stats, job->mappers, mapper_count, MR_PHASE_MAP, 0);
+
+  for (size_t i = 0; i < mapper_count; i++) {
+    struct mr_worker *m = &job->mappers[i];
+    stats->pairs_emitted += m->emitted;
+    stats->pairs_shuffled += m->shuffled;
+    stats->bytes_emitted += m->emitted * sizeof(struct mr_pair);
+    stats->bytes_shuffled += m->shuffled * sizeof(struct mr_pair);
+    stats->bytes_spilled += m->spill_size;
+    for (size_t j = 0; j < m->spill_count; j++) {
+      stats->spill_runs += m->spill_runs[j].mem == NULL;
+    }
+  }
+  return 0;
+}
+
+// Hands the mappers' output to the reducers: merged globally with range
+// partitioning, or left with the mappers for reducers to gather or stream
+// Returns 0 on success, -1 on failure
+int mr_shuffle_phase(struct mr_job *job, struct mr_stats *stats) {
+  bool hashed = job->opts.partition == MR_PARTITION_HASH;
+  // With a budget reducers stream the mappers' runs, which must stay around;
+  // hashed buckets and sampled ranges skip the global merge, reducers read
+  // the mappers' output directly
+  if (job->spill_pairs > 0) {
+    if (!hashed && mr_spill_bounds(job) != 0) {
+      return -1;
+    }
+  } else if (job->opts.partition == MR_PARTITION_SAMPLE) {
+    if (mr_sample_bounds(job) != 0) {
+      return -1;
+    }
+  } else if (!hashed) {
+    if (mr_shuffle(job) != 0 || mr_split_hot(job) != 0) {
+      return -1;
+    }
+    stats->hot_keys = job->hot_count;
+    workers_free(job->mappers, job->mapper_count);
+    job->mappers = NULL;
+  }
+  mr_lap(job, stats, MR_PHASE_SHUFFLE);
+  return 0;
+}
+
+// Runs the reducers over the shuffled pairs and assembles the output
+// With output NULL each reducer's sorted pairs are left in its final
+// Returns 0 on success, -1 on failure
+int mr_reduce_phase(struct mr_job *job, struct mr_stats *stats,
+                    struct mr_output *output) {
+  size_t reducer_count = job->reducer_count;
+  job->reducers = workers_new(job, MR_REDUCER, reducer_count);
+  if (job->reducers == NULL) {
+    return -1;
+  }
+  if (job->direct) {
+    if ((job->opts.partition == MR_PARTITION_SAMPLE &&
+         (mr_run_workers(job, job->reducers, reducer_count, gather_worker) !=
+              0 ||
+          workers_failed(job->reducers, reducer_count))) ||
+        mr_direct_layout(job) != 0) {
+      return -1;
+    }
+  }
+
+  if (mr_run_workers(job, job->reducers, reducer_count, reduce_worker) != 0 ||
+      workers_failed(job->reducers, reducer_count) ||
+      mr_merge_hot(job) != 0) {
+    return -1;
+  }
+  mr_lap(job, stats, MR_PHASE_REDUCE);
+  mr_collect_workers(job, stats, job->reducers, reducer_count,
+                     MR_PHASE_REDUCE, job->mapper_count);
+  for (size_t i = 0; i < reducer_count; i++) {
+    stats->bytes_output +=
+        job->reducers[i].final_count * sizeof(struct mr_pair);
+  }
+
+  if (output == NULL) {
+    return 0;
+  }
+  int res = job->direct ? mr_direct_assemble(job, output)
+                        : mr_assemble(job, output);
+  mr_lap(job, stats, MR_PHASE_OUTPUT);
+  stats->phases[MR_PHASE_OUTPUT].cpu += job->merge_cpu;
+  return res;
+}
+
+// Releases the job's workers, spill files and arenas, not its output
+// Returns the number of chunks they mapped
+size_t mr_job_release(struct mr_job *job) {
+  workers_free(job->mappers, job->mapper_count);
+  workers_free(job->reducers, job->reducer_count);
+  job->mappers = job->reducers = NULL;
+  size_t maps = job->maps + job->arena.maps;
+  mr_arena_release(&job->direct_out);
+  mr_arena_release(&job->arena);
+  return maps;
+}
+
+int mr_exec_ext(const struct mr_input *input,
+                void (*map)(const struct mr_in_kv *), size_t mapper_count,
+                void (*reduce)(const struct mr_out_kv *), size_t reducer_count,
+                struct mr_output *output, const struct mr_options *options) {
+  if (output == NULL) {
+    return -1;
+  }
+  output->kv_lst = NULL;
+  output->count = 0;
+
+  struct mr_job job;
+  if (input == NULL || (input->kv_lst == NULL && input->count > 0) ||
+      mr_job_init(&job, map, mapper_count, reduce, reducer_count, options) !=
+          0) {
+    return -1;
+  }
+  job.input = input;
+
+  int res = -1;
+  struct mr_stats stats = {
+      .mapper_count = mapper_count,
+      .reducer_count = reducer_count,
+  };
+  mr_lap(&job, &stats, MR_PHASE_COUNT);
+  if (mr_placement_init(&job) == 0 && mr_map_phase(&job, &stats) == 0 &&
+      mr_shuffle_phase(&job, &stats) == 0) {
+    res = mr_reduce_phase(&job, &stats, output);
+  }
+  stats.allocations = mr_job_release(&job) + job.output_allocs;
+  if (res == 0 && job.opts.stats != NULL) {
+    *job.opts.stats = stats;
+  }
+  return res;
+}
+
+int mr_exec(const struct mr_input *input, void (*map)(const struct mr_in_kv *),
+            size_t mapper_count, void (*reduce)(const struct mr_out_kv *),
+            size_t reducer_count, struct mr_output *output) {
+  return mr_exec_ext(input, map, mapper_count, reduce, reducer_count, output,
+                     NULL);
+}
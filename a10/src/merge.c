@@ -0,0 +1,359 @@
+#include "framework.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MR_MERGE_PARALLEL_MIN 65536
+#define MR_MERGE_SAMPLES 16
+
+// Key range of the final output merged by one thread
+struct merge_task {
+  struct mr_run *runs;       // slice of every reducer run inside the range
+  const struct mr_pair *src; // sorted pairs to fill kv_lst from
+  size_t pair_offset;  // first slot in the merged pairs
+  size_t pair_count;
+  size_t key_offset; // first slot in kv_lst
+  size_t key_count;
+  double cpu; // seconds spent by the thread running the task
+  bool failed;
+};
+
+// Shared state of the final merge, one task per participating thread
+struct mr_merge {
+  struct merge_task *tasks;
+  size_t task_count;
+  bool parallel;         // one thread per task, else all on the caller
+  int phase;             // 0 merges into pairs, 1 fills kv_lst
+  struct mr_pair *pairs; // merged final pairs
+  struct mr_out_kv *kv_lst;
+  char (*values)[MAX_VALUE_SIZE]; // all values, arena output only
+};
+
+// Sorts the reducer's own emitted pairs into its final run
+// Reducers usually emit in key order, then this is a single copy
+// Returns 0 on success, -1 on failure
+int mr_prepare_final(struct mr_worker *reducer) {
+  size_t count = reducer->out.count;
+  reducer->final_count = count;
+  if (count == 0) {
+    return 0;
+  }
+
+  reducer->final =
+      mr_arena_alloc(&reducer->arena, count * sizeof(struct mr_pair));
+  if (reducer->final == NULL) {
+    return -1;
+  }
+  mr_buffer_copy(&reducer->out, reducer->final);
+
+  const struct mr_pair *final = reducer->final;
+  for (size_t i = 1; i < count; i++) {
+    if (mr_key_cmp(final[i - 1].key, final[i].key) > 0) {
+      if (mr_sort_pairs(&reducer->arena, reducer->final, count,
+                        reducer->job->opts.grouping) != 0) {
+        return -1;
+      }
+      break;
+    }
+  }
+
+  reducer->final_keys = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (i == 0 || !mr_key_eq(final[i - 1].key, final[i].key)) {
+      reducer->final_keys++;
+    }
+  }
+  return 0;
+}
+
+static int sample_cmp(const void *a, const void *b) {
+  return mr_key_cmp(a, b);
+}
+
+// Picks task_count - 1 splitter keys from evenly spaced samples of the runs
+// Equal keys always fall on the same side of a splitter
+static int pick_splitters(struct mr_job *job, size_t task_count,
+                          char (*split)[MAX_KEY_SIZE]) {
+  size_t per_run = task_count * MR_MERGE_SAMPLES, n = 0;
+  char(*samples)[MAX_KEY_SIZE] = mr_arena_alloc(
+      &job->arena, job->reducer_count * per_run * MAX_KEY_SIZE);
+  if (samples == NULL) {
+    return -1;
+  }
+
+  for (size_t r = 0; r < job->reducer_count; r++) {
+    const struct mr_worker *w = &job->reducers[r];
+    for (size_t i = 0; i < per_run && i < w->final_count; i++) {
+      size_t pos = (size_t)((double)i * w->final_count / per_run);
+      memcpy(samples[n++], w->final[pos].key, MAX_KEY_SIZE);
+    }
+  }
+  qsort(samples, n, MAX_KEY_SIZE, sample_cmp);
+
+  for (size_t t = 1; t < task_count; t++) {
+    memcpy(split[t - 1], samples[t * n / task_count], MAX_KEY_SIZE);
+  }
+  return 0;
+}
+
+// Merges the task's slices and counts the distinct keys among them
+static void merge_slices(struct mr_job *job, struct merge_task *task) {
+  struct mr_merge *m = job->merge;
+  struct mr_pair *dst = m->pairs + task->pair_offset;
+
+  mr_merge_runs(task->runs, job->reducer_count, dst);
+  task->src = dst;
+  for (size_t i = 0; i < task->pair_count; i++) {
+    if (i == 0 || !mr_key_eq(dst[i - 1].key, dst[i].key)) {
+      task->key_count++;
+    }
+  }
+}
+
+// Writes the task's entries of kv_lst from its merged pairs
+static void fill_entries(struct mr_job *job, struct merge_task *task) {
+  struct mr_merge *m = job->merge;
+  const struct mr_pair *pairs = task->src;
+  struct mr_out_kv *kv_lst = m->kv_lst + task->key_offset;
+  size_t k = 0;
+
+  for (size_t i = 0; i < task->pair_count;) {
+    size_t end = i + 1;
+    while (end < task->pair_count &&
+           mr_key_eq(pairs[i].key, pairs[end].key)) {
+      end++;
+    }
+
+    struct mr_out_kv *kv = &kv_lst[k++];
+    memcpy(kv->key, pairs[i].key, MAX_KEY_SIZE);
+    kv->count = end - i;
+    if (m->values != NULL) {
+      kv->value = &m->values[task->pair_offset + i];
+    } else {
+      kv->value = malloc(kv->count * MAX_VALUE_SIZE);
+      if (kv->value == NULL) {
+        task->failed = true;
+        return;
+      }
+    }
+    for (size_t j = i; j < end; j++) {
+      memcpy(kv->value[j - i], pairs[j].value, MAX_VALUE_SIZE);
+    }
+    i = end;
+  }
+}
+
+static void *merge_worker(void *arg) {
+  struct mr_worker *self = arg;
+  struct mr_job *job = self->job;
+  struct merge_task *task = &job->merge->tasks[self->index];
+  double cpu = mr_timed(job) ? mr_cpu_time() : 0;
+
+  if (job->merge->phase == 0) {
+    merge_slices(job, task);
+  } else {
+    fill_entries(job, task);
+  }
+  if (mr_timed(job)) {
+    task->cpu += mr_cpu_time() - cpu;
+  }
+  return NULL;
+}
+
+// Runs the current merge phase on every task, in parallel if there are many
+static int run_phase(struct mr_job *job, int phase) {
+  struct mr_merge *m = job->merge;
+  m->phase = phase;
+  if (m->parallel) {
+    return mr_run_workers(job, job->reducers, m->task_count, merge_worker);
+  }
+  for (size_t t = 0; t < m->task_count; t++) {
+    merge_worker(&job->reducers[t]);
+  }
+  return 0;
+}
+
+// Whether each reducer's keys all sort before the next reducer's, as with
+// range partitioning; their outputs then only need to be concatenated
+static bool outputs_ordered(const struct mr_job *job) {
+  const struct mr_pair *last = NULL;
+  for (size_t r = 0; r < job->reducer_count; r++) {
+    const struct mr_worker *w = &job->reducers[r];
+    if (w->final_count == 0) {
+      continue;
+    }
+    if (last != NULL && mr_key_cmp(last->key, w->final[0].key) >= 0) {
+      return false;
+    }
+    last = &w->final[w->final_count - 1];
+  }
+  return true;
+}
+
+// Lays out one task per reducer, copying its final run straight into its
+// slots of the output
+static int concat_tasks(struct mr_job *job, size_t *keys) {
+  struct mr_merge *m = job->merge;
+  size_t offset = 0;
+
+  m->task_count = job->reducer_count;
+  m->tasks = mr_arena_alloc(&job->arena, m->task_count * sizeof(*m->tasks));
+  if (m->tasks == NULL) {
+    return -1;
+  }
+  for (size_t r = 0; r < job->reducer_count; r++) {
+    const struct mr_worker *w = &job->reducers[r];
+    m->tasks[r] = (struct merge_task){
+        .src = w->final,
+        .pair_offset = offset,
+        .pair_count = w->final_count,
+        .key_offset = *keys,
+        .key_count = w->final_keys,
+    };
+    offset += w->final_count;
+    *keys += w->final_keys;
+  }
+  return 0;
+}
+
+// Lays out one task per key range picked by splitters, merges each range
+// and counts its keys
+static int merge_tasks(struct mr_job *job, size_t total, size_t *keys) {
+  struct mr_merge *m = job->merge;
+  size_t task_count = m->task_count, r_count = job->reducer_count;
+
+  m->tasks = mr_arena_alloc(&job->arena, task_count * sizeof(*m->tasks));
+  struct mr_run *runs =
+      mr_arena_alloc(&job->arena, task_count * r_count * sizeof(*runs));
+  char(*split)[MAX_KEY_SIZE] =
+      mr_arena_alloc(&job->arena, task_count * MAX_KEY_SIZE);
+  m->pairs = mr_arena_alloc(&job->arena, total * sizeof(struct mr_pair));
+  if (m->tasks == NULL || runs == NULL || split == NULL || m->pairs == NULL ||
+      pick_splitters(job, task_count, split) != 0) {
+    return -1;
+  }
+
+  size_t offset = 0;
+  for (size_t t = 0; t < task_count; t++) {
+    struct merge_task *task = &m->tasks[t];
+    *task = (struct merge_task){.runs = &runs[t * r_count]};
+    task->pair_offset = offset;
+
+    for (size_t r = 0; r < r_count; r++) {
+      const struct mr_worker *w = &job->reducers[r];
+      size_t begin = t == 0 ? 0
+                            : mr_lower_bound(w->final, w->final_count,
+                                             split[t - 1]);
+      size_t end = t == task_count - 1
+                       ? w->final_count
+                       : mr_lower_bound(w->final, w->final_count, split[t]);
+      task->runs[r] = (struct mr_run){w->final + begin, w->final + end, r};
+      task->pair_count += end - begin;
+    }
+    offset += task->pair_count;
+  }
+
+  if (run_phase(job, 0) != 0) {
+    return -1;
+  }
+  for (size_t t = 0; t < task_count; t++) {
+    m->tasks[t].key_offset = *keys;
+    *keys += m->tasks[t].key_count;
+  }
+  return 0;
+}
+
+// Allocates kv_lst and, for arena output, one array for all values
+static int alloc_output(struct mr_job *job, size_t total, size_t keys,
+                        struct mr_arena *out) {
+  struct mr_merge *m = job->merge;
+
+  if (!job->opts.arena_output) {
+    m->kv_lst = calloc(keys, sizeof(struct mr_out_kv));
+    job->output_allocs += keys + 1;
+    return m->kv_lst == NULL ? -1 : 0;
+  }
+
+  struct mr_output_head *head = mr_arena_alloc(
+      out, sizeof(*head) + keys * sizeof(struct mr_out_kv));
+  if (head == NULL) {
+    return -1;
+  }
+  m->values = mr_arena_alloc(out, total * MAX_VALUE_SIZE);
+  if (m->values == NULL) {
+    return -1;
+  }
+  m->kv_lst = (struct mr_out_kv *)(head + 1);
+  return 0;
+}
+
+// Builds the final output from the reducers' sorted final runs
+// Reducers with ordered, disjoint keys each copy their run into their part
+// of kv_lst. Otherwise splitter keys divide the key space into one range
+// per reducer thread; each thread merges its range into preallocated slots,
+// then fills its part of kv_lst. Pairs with equal keys become one entry, in
+// reducer order
+// Returns 0 on success, -1 on failure
+int mr_assemble(struct mr_job *job, struct mr_output *output) {
+  size_t total = 0, r_count = job->reducer_count;
+  for (size_t r = 0; r < r_count; r++) {
+    total += job->reducers[r].final_count;
+  }
+
+  output->kv_lst = NULL;
+  output->count = 0;
+  if (total == 0) {
+    return 0;
+  }
+
+  bool parallel = total >= MR_MERGE_PARALLEL_MIN;
+  struct mr_merge m = {.task_count = parallel ? r_count : 1,
+                       .parallel = parallel && r_count > 1};
+  job->merge = &m;
+
+  size_t keys = 0;
+  if (outputs_ordered(job) ? concat_tasks(job, &keys) != 0
+                           : merge_tasks(job, total, &keys) != 0) {
+    return -1;
+  }
+  size_t task_count = m.task_count;
+
+  struct mr_arena out = {0};
+  bool failed = alloc_output(job, total, keys, &out) != 0 ||
+                run_phase(job, 1) != 0;
+  for (size_t t = 0; t < task_count; t++) {
+    failed |= m.tasks[t].failed;
+    // Tasks run serially ran on the coordinating thread, already timed by it
+    job->merge_cpu += m.parallel ? m.tasks[t].cpu : 0;
+  }
+
+  if (failed) {
+    if (!job->opts.arena_output && m.kv_lst != NULL) {
+      for (size_t i = 0; i < keys; i++) {
+        free(m.kv_lst[i].value);
+      }
+      free(m.kv_lst);
+    }
+    mr_arena_release(&out);
+    return -1;
+  }
+
+  if (job->opts.arena_output) {
+    job->output_allocs += out.maps;
+    ((struct mr_output_head *)m.kv_lst - 1)->arena = out;
+  }
+  output->kv_lst = m.kv_lst;
+  output->count = keys;
+  return 0;
+}
+
+void mr_release_output(struct mr_output *output) {
+  if (output == NULL || output->kv_lst == NULL) {
+    return;
+  }
+
+  struct mr_output_head *head = (struct mr_output_head *)output->kv_lst - 1;
+  struct mr_arena arena = head->arena;
+  mr_arena_release(&arena);
+  output->kv_lst = NULL;
+  output->count = 0;
+}
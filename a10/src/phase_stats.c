@@ -0,0 +1,65 @@
+#include "interface.h"
+#include "tests.h"
+#include <stdio.h>
+
+#define PHS_MAPPERS 4
+#define PHS_REDUCERS 4
+
+// Word count with every stat requested
+int phs_run(struct mr_stats *stats, struct mr_thread_stats *threads) {
+  struct mr_input phs_input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  struct mr_output phs_output;
+  struct mr_options opts = {.stats = stats, .thread_stats = threads};
+
+  int res = mr_exec_ext(&phs_input, amr_map, PHS_MAPPERS, amr_reduce,
+                        PHS_REDUCERS, &phs_output, &opts);
+  if (res == 0 && (phs_output.count != 57 || amr_cmp(&phs_output) != 0)) {
+    res = -1;
+  }
+  free_output(&phs_output);
+  return res;
+}
+
+bool phase_stats(void) {
+  struct mr_stats stats;
+  struct mr_thread_stats threads[PHS_MAPPERS + PHS_REDUCERS];
+
+  bool res = phs_run(&stats, threads) == 0 &&
+             stats.mapper_count == PHS_MAPPERS &&
+             stats.reducer_count == PHS_REDUCERS;
+
+  size_t records = 0, emitted = 0, keys = 0, output = 0;
+  for (size_t i = 0; res && i < PHS_MAPPERS + PHS_REDUCERS; i++) {
+    bool mapper = i < PHS_MAPPERS;
+    records += mapper ? threads[i].records : 0;
+    emitted += mapper ? threads[i].emitted : 0;
+    keys += mapper ? 0 : threads[i].records;
+    output += mapper ? 0 : threads[i].emitted;
+    res = threads[i].wall >= 0 && threads[i].cpu >= 0;
+  }
+  res = res && records == MAX_DATA_SIZE && emitted == stats.pairs_emitted &&
+        keys == 57 && output == 57 &&
+        stats.bytes_output == 57 * (MAX_KEY_SIZE + MAX_VALUE_SIZE);
+
+  for (size_t i = 0; res && i < MR_PHASE_COUNT; i++) {
+    struct mr_phase_stats *p = &stats.phases[i];
+    res = p->wall >= 0 && p->cpu >= 0 && p->thread_min <= p->thread_max;
+  }
+  TEST(res, 0);
+
+  return res;
+}
+
+// Prints where the time of one word count goes, for a10 --stats
+void print_phase_stats(void) {
+  struct mr_stats stats;
+  struct mr_thread_stats threads[PHS_MAPPERS + PHS_REDUCERS];
+
+  if (phs_run(&stats, threads) != 0) {
+    printf("word count failed\n");
+    return;
+  }
+  printf("word count, %d records, %d mappers, %d reducers\n", MAX_DATA_SIZE,
+         PHS_MAPPERS, PHS_REDUCERS);
+  mr_stats_print(stdout, &stats, threads);
+}
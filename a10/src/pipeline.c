@@ -0,0 +1,104 @@
+#include "framework.h"
+
+// Reducer output is mapped in place as the next stage's input records
+_Static_assert(sizeof(struct mr_pair) == sizeof(struct mr_in_kv),
+               "pairs must be readable as input records");
+
+// A stage's job and stats, kept until the next stage has mapped its output
+struct mr_stage_run {
+  struct mr_job job;
+  struct mr_stats stats;
+  bool live; // job initialized, not released yet
+  bool done; // reduce phase finished
+};
+
+static void stage_release(struct mr_stage_run *run) {
+  if (!run->live) {
+    return;
+  }
+  run->stats.allocations = mr_job_release(&run->job) + run->job.output_allocs;
+  if (run->done && run->job.opts.stats != NULL) {
+    *run->job.opts.stats = run->stats;
+  }
+  run->live = false;
+}
+
+// Points each mapper of the stage at the sorted output of the matching
+// reducer of the one before
+// Returns 0 on success, -1 on failure
+static int stage_link(struct mr_job *job, const struct mr_job *prev) {
+  struct mr_input *slices =
+      mr_arena_alloc(&job->arena, job->mapper_count * sizeof(*slices));
+  if (slices == NULL) {
+    return -1;
+  }
+  for (size_t i = 0; i < job->mapper_count; i++) {
+    const struct mr_worker *r = &prev->reducers[i];
+    slices[i] = (struct mr_input){(struct mr_in_kv *)r->final, r->final_count};
+  }
+  job->slices = slices;
+  return 0;
+}
+
+int mr_pipeline(const struct mr_input *input, size_t mapper_count,
+                const struct mr_stage *stages, size_t count,
+                struct mr_output *output) {
+  if (output == NULL) {
+    return -1;
+  }
+  output->kv_lst = NULL;
+  output->count = 0;
+  if (input == NULL || (input->kv_lst == NULL && input->count > 0) ||
+      stages == NULL || count == 0) {
+    return -1;
+  }
+
+  // Stage k runs in runs[k % 2], the one before it still in the other
+  struct mr_stage_run runs[2] = {0};
+  struct mr_stage_run *prev = NULL;
+  int res = -1;
+  for (size_t k = 0; k < count; k++) {
+    const struct mr_stage *stage = &stages[k];
+    struct mr_stage_run *run = &runs[k % 2];
+    struct mr_job *job = &run->job;
+    size_t m = prev == NULL ? mapper_count : prev->job.reducer_count;
+    if (mr_job_init(job, stage->map, m, stage->reduce, stage->reducer_count,
+                    stage->options) != 0) {
+      goto out;
+    }
+    run->live = true;
+    run->done = false;
+    run->stats = (struct mr_stats){
+        .mapper_count = m,
+        .reducer_count = stage->reducer_count,
+    };
+    bool last = k + 1 == count;
+    job->direct &= last;
+    mr_lap(job, &run->stats, MR_PHASE_COUNT);
+
+    if (prev == NULL) {
+      job->input = input;
+    } else if (stage_link(job, &prev->job) != 0) {
+      goto out;
+    }
+    if (mr_placement_init(job) != 0 || mr_map_phase(job, &run->stats) != 0) {
+      goto out;
+    }
+    if (prev != NULL) {
+      stage_release(prev);
+    }
+
+    if (mr_shuffle_phase(job, &run->stats) != 0 ||
+        mr_reduce_phase(job, &run->stats, last ? output : NULL) != 0) {
+      goto out;
+    }
+    run->done = true;
+    prev = run;
+  }
+  res = 0;
+
+out:
+  stage_release(&runs[0]);
+  stage_release(&runs[1]);
+  return res;
+}
@@ -0,0 +1,46 @@
+#define _GNU_SOURCE
+#include "interface.h"
+#include "tests.h"
+#include <sched.h>
+
+bool placement(void) {
+  struct mr_input plc_input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  struct mr_output plc_output;
+  struct mr_thread_stats threads[2 * MAX_THREADS];
+
+  // Every policy gives the same output
+  bool res = true;
+  for (int p = MR_PLACE_NONE; p <= MR_PLACE_SCATTER; p++) {
+    struct mr_options opts = {.placement = p};
+    for (size_t n = 1; n <= MAX_THREADS; n *= 4) {
+      res = res &&
+            mr_exec_ext(&plc_input, amr_map, n, amr_reduce, n, &plc_output,
+                        &opts) == 0 &&
+            plc_output.count == 57 && amr_cmp(&plc_output) == 0;
+      free_output(&plc_output);
+    }
+  }
+
+  // A one-CPU list keeps every thread on the CPU this one runs on
+  int cpu = sched_getcpu();
+  struct mr_options opts = {.placement = MR_PLACE_LIST,
+                            .cpus = &cpu,
+                            .cpu_count = 1,
+                            .thread_stats = threads};
+  res = res && cpu >= 0 &&
+        mr_exec_ext(&plc_input, amr_map, 8, amr_reduce, 8, &plc_output,
+                    &opts) == 0 &&
+        plc_output.count == 57 && amr_cmp(&plc_output) == 0;
+  free_output(&plc_output);
+  for (size_t i = 0; res && i < 16; i++) {
+    res = threads[i].cpu_id == cpu;
+  }
+
+  // A list policy needs a list
+  opts.cpus = NULL;
+  res = res && mr_exec_ext(&plc_input, amr_map, 8, amr_reduce, 8,
+                           &plc_output, &opts) == -1;
+  TEST(res, 0);
+
+  return res;
+}
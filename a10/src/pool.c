@@ -0,0 +1,226 @@
+#include "framework.h"
+#include <stdlib.h>
+
+// Completion counter shared by the threads running one batch of workers
+struct gang {
+  size_t pending;
+  pthread_cond_t done;
+};
+
+// One parked thread; idle while task is NULL
+struct pool_thread {
+  struct mr_pool *pool;
+  pthread_t id;
+  pthread_cond_t wake;
+  void *(*task)(void *);
+  void *arg;
+  struct gang *gang;
+  bool busy; // claimed by a batch, possibly not started yet
+};
+
+struct mr_pool {
+  pthread_mutex_t lock;
+  struct pool_thread **threads;
+  size_t count;
+  size_t cap;
+  bool stopping;
+};
+
+static void *pool_loop(void *arg) {
+  struct pool_thread *self = arg;
+  struct mr_pool *pool = self->pool;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (self->task == NULL && !pool->stopping) {
+      pthread_cond_wait(&self->wake, &pool->lock);
+    }
+    if (self->task == NULL) {
+      break;
+    }
+
+    void *(*task)(void *) = self->task;
+    pthread_mutex_unlock(&pool->lock);
+    task(self->arg);
+    pthread_mutex_lock(&pool->lock);
+
+    self->task = NULL;
+    self->busy = false;
+    if (--self->gang->pending == 0) {
+      pthread_cond_signal(&self->gang->done);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+// Starts one more parked thread, called with the pool lock held
+static struct pool_thread *pool_grow(struct mr_pool *pool) {
+  if (pool->count == pool->cap) {
+    size_t cap = pool->cap == 0 ? 8 : pool->cap * 2;
+    struct pool_thread **threads =
+        realloc(pool->threads, cap * sizeof(*threads));
+    if (threads == NULL) {
+      return NULL;
+    }
+    pool->threads = threads;
+    pool->cap = cap;
+  }
+
+  struct pool_thread *t = calloc(1, sizeof(*t));
+  if (t == NULL) {
+    return NULL;
+  }
+  t->pool = pool;
+  pthread_cond_init(&t->wake, NULL);
+  if (pthread_create(&t->id, NULL, pool_loop, t) != 0) {
+    pthread_cond_destroy(&t->wake);
+    free(t);
+    return NULL;
+  }
+  pool->threads[pool->count++] = t;
+  return t;
+}
+
+struct mr_pool *mr_pool_create(size_t thread_count) {
+  struct mr_pool *pool = calloc(1, sizeof(*pool));
+  if (pool == NULL) {
+    return NULL;
+  }
+  pthread_mutex_init(&pool->lock, NULL);
+
+  pthread_mutex_lock(&pool->lock);
+  for (size_t i = 0; i < thread_count; i++) {
+    if (pool_grow(pool) == NULL) {
+      pthread_mutex_unlock(&pool->lock);
+      mr_pool_destroy(pool);
+      return NULL;
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return pool;
+}
+
+void mr_pool_destroy(struct mr_pool *pool) {
+  if (pool == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->stopping = true;
+  for (size_t i = 0; i < pool->count; i++) {
+    pthread_cond_signal(&pool->threads[i]->wake);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  for (size_t i = 0; i < pool->count; i++) {
+    pthread_join(pool->threads[i]->id, NULL);
+    pthread_cond_destroy(&pool->threads[i]->wake);
+    free(pool->threads[i]);
+  }
+  free(pool->threads);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool);
+}
+
+// Claims count threads, idle ones first and new ones if too few are idle,
+// and starts fn on each with the next of count args, size bytes apart
+// Called with the pool lock held
+// Returns 0 on success, -1 if the pool could not grow
+static int gang_start(struct mr_pool *pool, struct gang *gang, size_t count,
+                      void *(*fn)(void *), char *args, size_t size) {
+  struct pool_thread **claimed = malloc(count * sizeof(*claimed));
+  size_t n = 0;
+  for (size_t i = 0; claimed != NULL && i < pool->count && n < count; i++) {
+    if (!pool->threads[i]->busy) {
+      claimed[n] = pool->threads[i];
+      claimed[n++]->busy = true;
+    }
+  }
+  while (claimed != NULL && n < count) {
+    struct pool_thread *t = pool_grow(pool);
+    if (t == NULL) {
+      break;
+    }
+    claimed[n] = t;
+    claimed[n++]->busy = true;
+  }
+
+  int res = 0;
+  if (n < count) {
+    for (size_t i = 0; i < n; i++) {
+      claimed[i]->busy = false;
+    }
+    res = -1;
+  } else {
+    gang->pending = count;
+    for (size_t i = 0; i < count; i++) {
+      claimed[i]->task = fn;
+      claimed[i]->arg = args + i * size;
+      claimed[i]->gang = gang;
+      pthread_cond_signal(&claimed[i]->wake);
+    }
+  }
+  free(claimed);
+  return res;
+}
+
+// Runs fn for each worker on its own parked thread and waits for all
+// Each worker gets a distinct thread, growing the pool if too few are idle
+// Returns 0 on success, -1 if the pool could not grow
+int mr_pool_run(struct mr_pool *pool, struct mr_worker *workers, size_t count,
+                void *(*fn)(void *)) {
+  struct gang gang = {.pending = 0};
+  pthread_cond_init(&gang.done, NULL);
+
+  pthread_mutex_lock(&pool->lock);
+  int res = gang_start(pool, &gang, count, fn, (char *)workers,
+                       sizeof(*workers));
+  while (gang.pending > 0) {
+    pthread_cond_wait(&gang.done, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  pthread_cond_destroy(&gang.done);
+  return res;
+}
+
+// Task started on a pool thread by mr_pool_start
+struct mr_pool_task {
+  struct mr_pool *pool;
+  struct gang gang;
+};
+
+// Starts fn(arg) on a parked thread and returns without waiting for it
+// Returns NULL on failure
+struct mr_pool_task *mr_pool_start(struct mr_pool *pool, void *(*fn)(void *),
+                                   void *arg) {
+  struct mr_pool_task *task = malloc(sizeof(*task));
+  if (task == NULL) {
+    return NULL;
+  }
+  task->pool = pool;
+  task->gang.pending = 0;
+  pthread_cond_init(&task->gang.done, NULL);
+
+  pthread_mutex_lock(&pool->lock);
+  int res = gang_start(pool, &task->gang, 1, fn, arg, 0);
+  pthread_mutex_unlock(&pool->lock);
+  if (res != 0) {
+    pthread_cond_destroy(&task->gang.done);
+    free(task);
+    return NULL;
+  }
+  return task;
+}
+
+// Waits for a task started with mr_pool_start and frees it
+void mr_pool_join(struct mr_pool_task *task) {
+  pthread_mutex_lock(&task->pool->lock);
+  while (task->gang.pending > 0) {
+    pthread_cond_wait(&task->gang.done, &task->pool->lock);
+  }
+  pthread_mutex_unlock(&task->pool->lock);
+  pthread_cond_destroy(&task->gang.done);
+  free(task);
+}
@@ -0,0 +1,56 @@
+#include "interface.h"
+#include "tests.h"
+#include <stdio.h>
+
+bool pool_calls(void) {
+  struct mr_pool *pool = mr_pool_create(4);
+  if (pool == NULL) {
+    TEST(false, 0);
+    return false;
+  }
+
+  struct mr_options opts = {.pool = pool};
+  struct mr_in_kv pc_in_kvs[MAX_THREADS];
+  for (size_t i = 0; i < MAX_THREADS; i++) {
+    snprintf(pc_in_kvs[i].key, MAX_KEY_SIZE, "%zu", i);
+    snprintf(pc_in_kvs[i].value, MAX_VALUE_SIZE, "%zu", i);
+  }
+  struct mr_input pc_input = {pc_in_kvs, MAX_THREADS};
+  struct mr_output pc_output;
+
+  // Pool threads are reused, but each mapper and reducer has its own
+  bool res = true;
+  for (size_t i = 0; i < 5; i++) {
+    size_t n = 1 << (i + 1);
+
+    nmr_reset();
+    res = res &&
+          mr_exec_ext(&pc_input, nom_map, n, nom_reduce, 1, &pc_output,
+                      &opts) == 0 &&
+          thread_cmp(n) == 0 && !too_many_threads;
+    free_output(&pc_output);
+
+    nmr_reset();
+    res = res &&
+          mr_exec_ext(&pc_input, nor_map, 1, nor_reduce, n, &pc_output,
+                      &opts) == 0 &&
+          thread_cmp(n) == 0 && !too_many_threads;
+    free_output(&pc_output);
+  }
+
+  struct mr_input amr_input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  for (size_t m = 1; m <= MAX_THREADS; m *= 2) {
+    for (size_t r = 1; r <= MAX_THREADS; r *= 2) {
+      res = res &&
+            mr_exec_ext(&amr_input, amr_map, m, amr_reduce, r, &pc_output,
+                        &opts) == 0 &&
+            pc_output.count == 57 && amr_cmp(&pc_output) == 0;
+      free_output(&pc_output);
+    }
+  }
+
+  mr_pool_destroy(pool);
+  TEST(res, 0);
+
+  return res;
+}
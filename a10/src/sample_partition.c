@@ -0,0 +1,33 @@
+#include "interface.h"
+#include "tests.h"
+
+bool sample_partition(void) {
+  struct mr_input smp_input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  struct mr_output smp_output = {NULL, 0}, ref_output = {NULL, 0};
+  struct mr_options opts = {.partition = MR_PARTITION_SAMPLE};
+
+  bool res = true;
+  for (size_t m = 1; m <= MAX_THREADS; m *= 2) {
+    for (size_t r = 1; r <= MAX_THREADS; r *= 2) {
+      res = res &&
+            mr_exec_ext(&smp_input, amr_map, m, amr_reduce, r, &smp_output,
+                        &opts) == 0 &&
+            smp_output.count == 57 && amr_cmp(&smp_output) == 0;
+      free_output(&smp_output);
+
+      // Values keep mapper order, as with range partitioning
+      res = res &&
+            mr_exec_ext(&smp_input, spl_map, m, spl_reduce, r, &smp_output,
+                        &opts) == 0;
+      res = res &&
+            mr_exec(&smp_input, spl_map, m, spl_reduce, r, &ref_output) ==
+                0 &&
+            spl_cmp(&smp_output, &ref_output) == 0;
+      free_output(&smp_output);
+      free_output(&ref_output);
+    }
+  }
+  TEST(res, 0);
+
+  return res;
+}
@@ -0,0 +1,233 @@
+#include "framework.h"
+#include <stdlib.h>
+
+// Pairs of one or more consecutive batches, sorted by key
+struct mr_level {
+  struct mr_arena arena; // the pairs and nothing else
+  struct mr_pair *pairs;
+  size_t count;
+};
+
+struct mr_session {
+  void (*map)(const struct mr_in_kv *);
+  void (*reduce)(const struct mr_out_kv *);
+  size_t mapper_count;
+  size_t reducer_count;
+  struct mr_options opts;
+  struct mr_stats stats;   // summed over the batches pushed so far
+  size_t maps;             // chunks mapped by released jobs and levels
+  struct mr_level *levels; // oldest first, each over twice the next one
+  size_t level_count;
+  size_t level_cap;
+  bool failed; // a push failed, so the output would miss pairs
+};
+
+struct mr_session *mr_session_open(void (*map)(const struct mr_in_kv *),
+                                   size_t mapper_count,
+                                   void (*reduce)(const struct mr_out_kv *),
+                                   size_t reducer_count,
+                                   const struct mr_options *options) {
+  // Checked once here, so pushes only fail for lack of memory
+  struct mr_job job;
+  if (mr_job_init(&job, map, mapper_count, reduce, reducer_count, options) !=
+          0 ||
+      job.spill_pairs > 0) {
+    return NULL;
+  }
+
+  struct mr_session *session = calloc(1, sizeof(*session));
+  if (session == NULL) {
+    return NULL;
+  }
+  session->map = map;
+  session->reduce = reduce;
+  session->mapper_count = mapper_count;
+  session->reducer_count = reducer_count;
+  session->opts = job.opts;
+  session->opts.partition = MR_PARTITION_RANGE;
+  session->stats.mapper_count = mapper_count;
+  session->stats.reducer_count = reducer_count;
+  return session;
+}
+
+static void level_free(struct mr_session *session, struct mr_level *level) {
+  session->maps += level->arena.maps;
+  mr_arena_release(&level->arena);
+}
+
+// Merges the last two levels into one, older pairs first for equal keys
+// Returns 0 on success, -1 on failure
+static int level_merge(struct mr_session *session) {
+  struct mr_level *a = &session->levels[session->level_count - 2];
+  struct mr_level *b = a + 1;
+  struct mr_level merged = {.count = a->count + b->count};
+  merged.pairs =
+      mr_arena_alloc(&merged.arena, merged.count * sizeof(struct mr_pair));
+  if (merged.pairs == NULL) {
+    return -1;
+  }
+
+  struct mr_run runs[2] = {{a->pairs, a->pairs + a->count, 0},
+                           {b->pairs, b->pairs + b->count, 1}};
+  mr_merge_runs(runs, 2, merged.pairs);
+  level_free(session, a);
+  level_free(session, b);
+  *a = merged;
+  session->level_count--;
+  return 0;
+}
+
+// Merges the batch's mapper runs into a new level, in mapper order for
+// equal keys, then merges levels until each is over twice the next one
+// Returns 0 on success, -1 on failure
+static int level_add(struct mr_session *session, struct mr_job *job) {
+  size_t total = 0;
+  for (size_t i = 0; i < job->mapper_count; i++) {
+    total += job->mappers[i].run_count;
+  }
+  if (total == 0) {
+    return 0;
+  }
+
+  if (session->level_count == session->level_cap) {
+    size_t cap = session->level_cap == 0 ? 8 : 2 * session->level_cap;
+    struct mr_level *levels =
+        realloc(session->levels, cap * sizeof(*levels));
+    if (levels == NULL) {
+      return -1;
+    }
+    session->levels = levels;
+    session->level_cap = cap;
+  }
+
+  struct mr_level level = {.count = total};
+  level.pairs = mr_arena_alloc(&level.arena, total * sizeof(struct mr_pair));
+  struct mr_run *runs =
+      mr_arena_alloc(&job->arena, job->mapper_count * sizeof(*runs));
+  if (level.pairs == NULL || runs == NULL) {
+    level_free(session, &level);
+    return -1;
+  }
+  for (size_t i = 0; i < job->mapper_count; i++) {
+    struct mr_worker *m = &job->mappers[i];
+    runs[i] = (struct mr_run){m->run, m->run + m->run_count, i};
+  }
+  mr_merge_runs(runs, job->mapper_count, level.pairs);
+  session->levels[session->level_count++] = level;
+
+  while (session->level_count > 1 &&
+         session->levels[session->level_count - 2].count <=
+             2 * session->levels[session->level_count - 1].count) {
+    if (level_merge(session) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int mr_session_push(struct mr_session *session, const struct mr_in_kv *kv_lst,
+                    size_t count) {
+  if (session == NULL || session->failed || (kv_lst == NULL && count > 0)) {
+    return -1;
+  }
+  if (count == 0) {
+    return 0;
+  }
+
+  struct mr_job job;
+  if (mr_job_init(&job, session->map, session->mapper_count,
+                  session->reduce, session->reducer_count,
+                  &session->opts) != 0) {
+    return -1;
+  }
+  struct mr_input input = {(struct mr_in_kv *)kv_lst, count};
+  job.input = &input;
+
+  mr_lap(&job, &session->stats, MR_PHASE_COUNT);
+  int res = mr_placement_init(&job) != 0 ||
+                    mr_map_phase(&job, &session->stats) != 0 ||
+                    level_add(session, &job) != 0
+                ? -1
+                : 0;
+  mr_lap(&job, &session->stats, MR_PHASE_SHUFFLE);
+  session->maps += mr_job_release(&job);
+  session->failed |= res != 0;
+  return res;
+}
+
+// Merges the levels and reduces them like mr_exec_ext, into stats
+// The levels are freed as they are merged unless keep is set
+// Returns 0 on success, -1 on failure
+static int session_reduce(struct mr_session *session, struct mr_stats *stats,
+                          bool keep, struct mr_output *output) {
+  struct mr_job job;
+  if (mr_job_init(&job, session->map, session->mapper_count,
+                  session->reduce, session->reducer_count,
+                  &session->opts) != 0) {
+    return -1;
+  }
+  mr_lap(&job, stats, MR_PHASE_COUNT);
+
+  int res = -1;
+  size_t count = session->level_count;
+  struct mr_run *runs = mr_arena_alloc(&job.arena, count * sizeof(*runs));
+  if (runs == NULL || mr_placement_init(&job) != 0) {
+    goto out;
+  }
+  for (size_t i = 0; i < count; i++) {
+    const struct mr_level *level = &session->levels[i];
+    runs[i] = (struct mr_run){level->pairs, level->pairs + level->count, i};
+  }
+  if (mr_shuffle_runs(&job, runs, count) != 0 || mr_split_hot(&job) != 0) {
+    goto out;
+  }
+  stats->hot_keys = job.hot_count;
+  for (size_t i = 0; i < count && !keep; i++) {
+    level_free(session, &session->levels[i]);
+  }
+  session->level_count = keep ? count : 0;
+  mr_lap(&job, stats, MR_PHASE_SHUFFLE);
+
+  res = mr_reduce_phase(&job, stats, output);
+
+out:
+  session->maps += mr_job_release(&job);
+  stats->allocations = session->maps + job.output_allocs;
+  if (res == 0 && session->opts.stats != NULL) {
+    *session->opts.stats = *stats;
+  }
+  return res;
+}
+
+int mr_session_peek(struct mr_session *session, struct mr_output *output) {
+  if (output != NULL) {
+    output->kv_lst = NULL;
+    output->count = 0;
+  }
+  if (session == NULL || output == NULL || session->failed) {
+    return -1;
+  }
+  // Times a copy, so the session's own stats only cover what close reports
+  struct mr_stats stats = session->stats;
+  return session_reduce(session, &stats, true, output);
+}
+
+int mr_session_close(struct mr_session *session, struct mr_output *output) {
+  if (output != NULL) {
+    output->kv_lst = NULL;
+    output->count = 0;
+  }
+  if (session == NULL) {
+    return -1;
+  }
+
+  int res = output == NULL || session->failed
+                ? -1
+                : session_reduce(session, &session->stats, false, output);
+  for (size_t i = 0; i < session->level_count; i++) {
+    level_free(session, &session->levels[i]);
+  }
+  free(session->levels);
+  free(session);
+  return res;
+}
@@ -0,0 +1,349 @@
+#include "framework.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MR_SAMPLES_PER_REDUCER 64
+
+static bool run_less(const struct mr_run *a, const struct mr_run *b) {
+  int c = mr_key_cmp(a->pos->key, b->pos->key);
+  return c < 0 || (c == 0 && a->index < b->index);
+}
+
+static void sift_down(struct mr_run *heap, size_t count, size_t i) {
+  for (;;) {
+    size_t min = i, l = 2 * i + 1, r = 2 * i + 2;
+    if (l < count && run_less(&heap[l], &heap[min])) {
+      min = l;
+    }
+    if (r < count && run_less(&heap[r], &heap[min])) {
+      min = r;
+    }
+    if (min == i) {
+      return;
+    }
+    struct mr_run tmp = heap[i];
+    heap[i] = heap[min];
+    heap[min] = tmp;
+    i = min;
+  }
+}
+
+// Drops empty runs and orders the rest into a heap
+// Returns the number of runs left
+static size_t heap_init(struct mr_run *runs, size_t count) {
+  size_t n = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (runs[i].pos != runs[i].end) {
+      runs[n++] = runs[i];
+    }
+  }
+  for (size_t i = n; i-- > 0;) {
+    sift_down(runs, n, i);
+  }
+  return n;
+}
+
+// Takes the smallest pair off a heap of n > 1 runs
+static inline const struct mr_pair *heap_pop(struct mr_run *runs, size_t *n) {
+  const struct mr_pair *pair = runs[0].pos++;
+  if (runs[0].pos == runs[0].end) {
+    runs[0] = runs[--*n];
+  }
+  sift_down(runs, *n, 0);
+  return pair;
+}
+
+// K-way merge of sorted runs into dst, using runs as the heap
+// Equal keys are taken from the run with the lowest index first
+void mr_merge_runs(struct mr_run *runs, size_t count, struct mr_pair *dst) {
+  size_t n = heap_init(runs, count);
+  while (n > 1) {
+    *dst++ = *heap_pop(runs, &n);
+  }
+  if (n == 1) {
+    memcpy(dst, runs[0].pos, (runs[0].end - runs[0].pos) * sizeof(*dst));
+  }
+}
+
+// Same as mr_merge_runs, writing straight into columns with room for every
+// pair, so the merged pairs are never stored as pairs
+static void merge_columns(struct mr_run *runs, size_t count,
+                          struct mr_columns *cols) {
+  size_t n = heap_init(runs, count);
+  cols->count = 0;
+  size_t total = 0;
+  while (n > 1) {
+    mr_columns_push(cols, heap_pop(runs, &n), total++);
+  }
+  if (n == 1) {
+    for (const struct mr_pair *p = runs[0].pos; p != runs[0].end; p++) {
+      mr_columns_push(cols, p, total++);
+    }
+  }
+  cols->offsets[cols->count] = total;
+}
+
+// Allocates columns for up to count pairs, as many keys at most
+// Returns 0 on success, -1 on failure
+static int columns_alloc(struct mr_arena *arena, struct mr_columns *cols,
+                         size_t count) {
+  cols->count = 0;
+  cols->keys = mr_arena_alloc(arena, count * MAX_KEY_SIZE);
+  cols->values = mr_arena_alloc(arena, count * MAX_VALUE_SIZE);
+  cols->offsets = mr_arena_alloc(arena, (count + 1) * sizeof(size_t));
+  return cols->keys == NULL || cols->values == NULL || cols->offsets == NULL
+             ? -1
+             : 0;
+}
+
+// Merges sorted runs into one sorted array, or into the job's columns
+// unless pairs are wanted
+static int merge_runs(struct mr_job *job, struct mr_run *runs, size_t count) {
+  size_t total = 0;
+  for (size_t i = 0; i < count; i++) {
+    total += runs[i].end - runs[i].pos;
+  }
+
+  job->pair_count = total;
+  job->pairs = NULL;
+  if (total == 0) {
+    return 0;
+  }
+
+  if (job->opts.layout != MR_LAYOUT_PAIRS) {
+    if (columns_alloc(&job->arena, &job->cols, total) != 0) {
+      return -1;
+    }
+    merge_columns(runs, count, &job->cols);
+  } else {
+    job->pairs = mr_arena_alloc(&job->arena, total * sizeof(struct mr_pair));
+    if (job->pairs == NULL) {
+      return -1;
+    }
+    mr_merge_runs(runs, count, job->pairs);
+  }
+  return 0;
+}
+
+// Splits sorted pairs into ranges of equal keys
+// Returns 0 on success, -1 on failure
+int mr_find_groups(struct mr_arena *arena, const struct mr_pair *pairs,
+                   size_t count, struct mr_group **groups, size_t *group_count) {
+  size_t n = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (i == 0 || !mr_key_eq(pairs[i - 1].key, pairs[i].key)) {
+      n++;
+    }
+  }
+
+  *groups = NULL;
+  *group_count = n;
+  if (n == 0) {
+    return 0;
+  }
+
+  struct mr_group *g = mr_arena_alloc(arena, n * sizeof(*g));
+  if (g == NULL) {
+    return -1;
+  }
+
+  size_t k = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (i == 0 || !mr_key_eq(pairs[i - 1].key, pairs[i].key)) {
+      if (k > 0) {
+        g[k - 1].end = i;
+      }
+      g[k++].begin = i;
+    }
+  }
+  g[k - 1].end = count;
+  *groups = g;
+  return 0;
+}
+
+// Merges sorted runs into globally sorted groups of equal keys, equal keys
+// coming from the run with the lowest index first
+// Returns 0 on success, -1 on failure
+int mr_shuffle_runs(struct mr_job *job, struct mr_run *runs, size_t count) {
+  if (merge_runs(job, runs, count) != 0) {
+    return -1;
+  }
+  if (job->opts.layout != MR_LAYOUT_PAIRS) {
+    job->group_count = job->cols.count;
+    return 0;
+  }
+  return mr_find_groups(&job->arena, job->pairs, job->pair_count,
+                        &job->groups, &job->group_count);
+}
+
+// Gathers all mapper output into globally sorted groups of equal keys
+// Returns 0 on success, -1 on failure
+int mr_shuffle(struct mr_job *job) {
+  struct mr_run *runs =
+      mr_arena_alloc(&job->arena, job->mapper_count * sizeof(*runs));
+  if (runs == NULL) {
+    return -1;
+  }
+  for (size_t i = 0; i < job->mapper_count; i++) {
+    struct mr_worker *m = &job->mappers[i];
+    runs[i] = (struct mr_run){m->run, m->run + m->run_count, i};
+  }
+  return mr_shuffle_runs(job, runs, job->mapper_count);
+}
+
+// Groups the reducer's sorted run, into columns or into groups of the run
+// Returns 0 on success, -1 on failure
+static int group_run(struct mr_job *job, struct mr_worker *reducer) {
+  if (job->opts.layout == MR_LAYOUT_PAIRS) {
+    return mr_find_groups(&reducer->arena, reducer->run, reducer->run_count,
+                          &reducer->groups, &reducer->group_count);
+  }
+  if (columns_alloc(&reducer->arena, &reducer->cols, reducer->run_count) !=
+      0) {
+    return -1;
+  }
+  struct mr_columns *cols = &reducer->cols;
+  for (size_t i = 0; i < reducer->run_count; i++) {
+    mr_columns_push(cols, &reducer->run[i], i);
+  }
+  cols->offsets[cols->count] = reducer->run_count;
+  reducer->group_count = cols->count;
+  return 0;
+}
+
+// Collects the reducer's bucket from every mapper and groups it locally
+// Mapper order is kept, so values for a key stay in emit order
+// Returns 0 on success, -1 on failure
+int mr_gather_bucket(struct mr_job *job, struct mr_worker *reducer) {
+  size_t r = reducer->index, total = 0;
+  for (size_t i = 0; i < job->mapper_count; i++) {
+    total += job->mappers[i].parts[r].count;
+  }
+
+  reducer->run_count = total;
+  if (total == 0) {
+    return 0;
+  }
+
+  reducer->run =
+      mr_arena_alloc(&reducer->arena, total * sizeof(struct mr_pair));
+  if (reducer->run == NULL) {
+    return -1;
+  }
+
+  struct mr_pair *dst = reducer->run;
+  for (size_t i = 0; i < job->mapper_count; i++) {
+    mr_buffer_copy(&job->mappers[i].parts[r], dst);
+    dst += job->mappers[i].parts[r].count;
+  }
+
+  if (mr_sort_pairs(&reducer->arena, reducer->run, total,
+                    job->opts.grouping) != 0) {
+    return -1;
+  }
+  return group_run(job, reducer);
+}
+
+// First position in the sorted pairs whose key is not less than key
+size_t mr_lower_bound(const struct mr_pair *pairs, size_t count,
+                      const char *key) {
+  size_t lo = 0, hi = count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (mr_key_cmp(pairs[mid].key, key) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static int key_cmp(const void *a, const void *b) { return mr_key_cmp(a, b); }
+
+// Picks reducer_count - 1 split keys from evenly spaced samples of the
+// mappers' sorted runs, weighting each run by its size
+// Returns 0 on success, -1 on failure
+int mr_sample_bounds(struct mr_job *job) {
+  size_t r_count = job->reducer_count, total = 0, n = 0;
+  for (size_t i = 0; i < job->mapper_count; i++) {
+    total += job->mappers[i].run_count;
+  }
+
+  size_t want = r_count * MR_SAMPLES_PER_REDUCER;
+  job->bounds = mr_arena_alloc(&job->arena, r_count * MAX_KEY_SIZE);
+  if (job->bounds == NULL) {
+    return -1;
+  }
+  struct mr_arena_mark mark = mr_arena_mark(&job->arena);
+  char(*samples)[MAX_KEY_SIZE] =
+      mr_arena_alloc(&job->arena, (want + job->mapper_count) * MAX_KEY_SIZE);
+  if (samples == NULL) {
+    return -1;
+  }
+
+  for (size_t i = 0; i < job->mapper_count && total > 0; i++) {
+    const struct mr_worker *m = &job->mappers[i];
+    size_t take = (want * m->run_count + total - 1) / total;
+    for (size_t j = 0; j < take && j < m->run_count; j++) {
+      size_t pos = (size_t)((double)j * m->run_count / take);
+      memcpy(samples[n++], m->run[pos].key, MAX_KEY_SIZE);
+    }
+  }
+  qsort(samples, n, MAX_KEY_SIZE, key_cmp);
+
+  // Without samples every split is the empty key, so reducer 0 gets all
+  memset(job->bounds, 0, r_count * MAX_KEY_SIZE);
+  for (size_t r = 1; r < r_count && n > 0; r++) {
+    memcpy(job->bounds[r], samples[r * n / r_count], MAX_KEY_SIZE);
+  }
+  mr_arena_reset(&job->arena, mark);
+  return 0;
+}
+
+// Merges the reducer's key range out of every mapper run and groups it,
+// merging straight into columns unless pairs are wanted
+// Ties go to the lower mapper, so values for a key stay in emit order
+// Returns 0 on success, -1 on failure
+int mr_gather_range(struct mr_job *job, struct mr_worker *reducer) {
+  size_t r = reducer->index;
+  bool last = r + 1 == job->reducer_count;
+  struct mr_run *runs =
+      mr_arena_alloc(&reducer->arena, job->mapper_count * sizeof(*runs));
+  if (runs == NULL) {
+    return -1;
+  }
+
+  size_t total = 0;
+  for (size_t i = 0; i < job->mapper_count; i++) {
+    const struct mr_worker *m = &job->mappers[i];
+    size_t begin = r == 0 ? 0
+                          : mr_lower_bound(m->run, m->run_count,
+                                           job->bounds[r]);
+    size_t end = last ? m->run_count
+                      : mr_lower_bound(m->run, m->run_count,
+                                       job->bounds[r + 1]);
+    runs[i] = (struct mr_run){m->run + begin, m->run + end, i};
+    total += end - begin;
+  }
+
+  if (total == 0) {
+    return 0;
+  }
+  if (job->opts.layout != MR_LAYOUT_PAIRS) {
+    if (columns_alloc(&reducer->arena, &reducer->cols, total) != 0) {
+      return -1;
+    }
+    merge_columns(runs, job->mapper_count, &reducer->cols);
+    reducer->group_count = reducer->cols.count;
+    return 0;
+  }
+
+  reducer->run_count = total;
+  reducer->run = mr_arena_alloc(&reducer->arena, total * sizeof(struct mr_pair));
+  if (reducer->run == NULL) {
+    return -1;
+  }
+  mr_merge_runs(runs, job->mapper_count, reducer->run);
+  return group_run(job, reducer);
+}
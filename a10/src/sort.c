@@ -0,0 +1,146 @@
+#include "framework.h"
+#include <stdint.h>
+#include <string.h>
+
+#define MR_INSERTION_RUN 16
+#define MR_RADIX_MIN 256
+
+static void insertion_sort(struct mr_pair *pairs, size_t count) {
+  for (size_t i = 1; i < count; i++) {
+    if (mr_key_cmp(pairs[i - 1].key, pairs[i].key) <= 0) {
+      continue;
+    }
+    struct mr_pair tmp = pairs[i];
+    size_t j = i;
+    while (j > 0 && mr_key_cmp(pairs[j - 1].key, tmp.key) > 0) {
+      pairs[j] = pairs[j - 1];
+      j--;
+    }
+    pairs[j] = tmp;
+  }
+}
+
+// Merges src[lo, mid) and src[mid, hi) into dst[lo, hi), left side first
+static void merge(const struct mr_pair *src, struct mr_pair *dst, size_t lo,
+                  size_t mid, size_t hi) {
+  size_t i = lo, j = mid, k = lo;
+
+  while (i < mid && j < hi) {
+    if (mr_key_cmp(src[j].key, src[i].key) < 0) {
+      dst[k++] = src[j++];
+    } else {
+      dst[k++] = src[i++];
+    }
+  }
+  memcpy(&dst[k], &src[i], (mid - i) * sizeof(*src));
+  k += mid - i;
+  memcpy(&dst[k], &src[j], (hi - j) * sizeof(*src));
+}
+
+// Stable bottom-up merge sort by key, so equal keys keep their emit order
+// Returns 0 on success, -1 on failure
+static int merge_sort(struct mr_arena *arena, struct mr_pair *pairs,
+                      size_t count) {
+  for (size_t lo = 0; lo < count; lo += MR_INSERTION_RUN) {
+    size_t n = count - lo < MR_INSERTION_RUN ? count - lo : MR_INSERTION_RUN;
+    insertion_sort(&pairs[lo], n);
+  }
+  if (count <= MR_INSERTION_RUN) {
+    return 0;
+  }
+
+  struct mr_arena_mark mark = mr_arena_mark(arena);
+  struct mr_pair *tmp = mr_arena_alloc(arena, count * sizeof(*tmp));
+  if (tmp == NULL) {
+    return -1;
+  }
+
+  struct mr_pair *src = pairs, *dst = tmp;
+  for (size_t width = MR_INSERTION_RUN; width < count; width *= 2) {
+    for (size_t lo = 0; lo < count; lo += 2 * width) {
+      size_t mid = lo + width < count ? lo + width : count;
+      size_t hi = lo + 2 * width < count ? lo + 2 * width : count;
+      merge(src, dst, lo, mid, hi);
+    }
+    struct mr_pair *swap = src;
+    src = dst;
+    dst = swap;
+  }
+
+  if (src != pairs) {
+    memcpy(pairs, src, count * sizeof(*pairs));
+  }
+  mr_arena_reset(arena, mark);
+  return 0;
+}
+
+// Key byte i, counting from the most significant byte of the two words
+static inline uint8_t key_byte(uint64_t hi, uint64_t lo, size_t i) {
+  return i < 8 ? hi >> (56 - 8 * i) : lo >> (120 - 8 * i);
+}
+
+// Stable LSD radix sort by key, one byte per pass
+// Keys are read as two big-endian 64-bit words; passes where every key has
+// the same byte (e.g. the zero padding of short keys) are skipped
+// Returns 0 on success, -1 on failure
+static int radix_sort(struct mr_arena *arena, struct mr_pair *pairs,
+                      size_t count) {
+  struct mr_arena_mark mark = mr_arena_mark(arena);
+  size_t(*hist)[256] = mr_arena_alloc(arena, MAX_KEY_SIZE * sizeof(*hist));
+  struct mr_pair *tmp = hist == NULL
+                            ? NULL
+                            : mr_arena_alloc(arena, count * sizeof(*tmp));
+  if (tmp == NULL) {
+    mr_arena_reset(arena, mark);
+    return -1;
+  }
+  memset(hist, 0, MAX_KEY_SIZE * sizeof(*hist));
+
+  for (size_t i = 0; i < count; i++) {
+    uint64_t hi, lo;
+    memcpy(&hi, pairs[i].key, sizeof(hi));
+    memcpy(&lo, pairs[i].key + sizeof(hi), sizeof(lo));
+    hi = __builtin_bswap64(hi);
+    lo = __builtin_bswap64(lo);
+    for (size_t b = 0; b < MAX_KEY_SIZE; b++) {
+      hist[b][key_byte(hi, lo, b)]++;
+    }
+  }
+
+  struct mr_pair *src = pairs, *dst = tmp;
+  for (size_t b = MAX_KEY_SIZE; b-- > 0;) {
+    if (hist[b][(uint8_t)src[0].key[b]] == count) {
+      continue;
+    }
+
+    size_t offset[256], sum = 0;
+    for (size_t d = 0; d < 256; d++) {
+      offset[d] = sum;
+      sum += hist[b][d];
+    }
+    for (size_t i = 0; i < count; i++) {
+      dst[offset[(uint8_t)src[i].key[b]]++] = src[i];
+    }
+
+    struct mr_pair *swap = src;
+    src = dst;
+    dst = swap;
+  }
+
+  if (src != pairs) {
+    memcpy(pairs, src, count * sizeof(*pairs));
+  }
+  mr_arena_reset(arena, mark);
+  return 0;
+}
+
+// Stable sort by key with the given strategy, emit order kept for equal keys
+// Small inputs always use the merge sort
+// Returns 0 on success, -1 on failure
+int mr_sort_pairs(struct mr_arena *arena, struct mr_pair *pairs, size_t count,
+                  enum mr_grouping grouping) {
+  if (grouping == MR_GROUP_RADIX && count >= MR_RADIX_MIN) {
+    return radix_sort(arena, pairs, count);
+  }
+  return merge_sort(arena, pairs, count);
+}
@@ -0,0 +1,387 @@
+#include "framework.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MR_CURSOR_PAIRS 512
+
+// Sorted run read sequentially, buffered from memory or a spill file
+struct cursor {
+  const struct mr_pair *pos; // next buffered pair
+  const struct mr_pair *end;
+  int fd;      // -1 for a run kept in memory
+  off_t next;  // file offset of the first pair not yet buffered
+  off_t stop;  // file offset just past the run
+  struct mr_pair *buf;
+  size_t buf_count;
+  size_t index; // breaks ties, earlier emits first
+};
+
+// Opens a spill file in TMPDIR that is removed as soon as it is closed
+static int spill_open(void) {
+  const char *dir = getenv("TMPDIR");
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/mr_spill_XXXXXX",
+           dir != NULL && dir[0] != '\0' ? dir : "/tmp");
+
+  int fd = mkstemp(path);
+  if (fd >= 0) {
+    unlink(path);
+  }
+  return fd;
+}
+
+static int write_all(int fd, const void *data, size_t size) {
+  const char *p = data;
+  while (size > 0) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0) {
+      return -1;
+    }
+    p += n;
+    size -= n;
+  }
+  return 0;
+}
+
+static int add_run(struct mr_worker *w, size_t part,
+                   const struct mr_pair *mem, size_t offset, size_t count) {
+  if (w->spill_count == w->spill_cap) {
+    size_t cap = w->spill_cap == 0 ? 16 : w->spill_cap * 2;
+    struct mr_spill_run *runs = realloc(w->spill_runs, cap * sizeof(*runs));
+    if (runs == NULL) {
+      return -1;
+    }
+    w->spill_runs = runs;
+    w->spill_cap = cap;
+  }
+  w->spill_runs[w->spill_count++] =
+      (struct mr_spill_run){part, mem, offset, count};
+  return 0;
+}
+
+// Copies a part's buffered pairs into one array and sorts it
+static struct mr_pair *sort_part(struct mr_worker *w, size_t part) {
+  size_t count = w->parts[part].count;
+  struct mr_pair *pairs = mr_arena_alloc(&w->arena, count * sizeof(*pairs));
+  if (pairs == NULL) {
+    return NULL;
+  }
+  mr_buffer_copy(&w->parts[part], pairs);
+  mr_buffer_clear(&w->parts[part]);
+  if (mr_sort_pairs(&w->arena, pairs, count, w->job->opts.grouping) != 0) {
+    return NULL;
+  }
+  return pairs;
+}
+
+// Sorts the mapper's buffered pairs into one run per part and appends them
+// to its spill file, then rolls its arena back to reuse the memory
+// Returns 0 on success, -1 on failure
+int mr_spill(struct mr_worker *w) {
+  if (w->job->opts.combine != NULL && mr_combine_local(w) != 0) {
+    return -1;
+  }
+  if (w->spill_fd < 0 && (w->spill_fd = spill_open()) < 0) {
+    return -1;
+  }
+
+  for (size_t p = 0; p < w->part_count; p++) {
+    size_t count = w->parts[p].count;
+    if (count == 0) {
+      continue;
+    }
+
+    struct mr_pair *pairs = sort_part(w, p);
+    size_t size = count * sizeof(*pairs);
+    if (pairs == NULL || write_all(w->spill_fd, pairs, size) != 0 ||
+        add_run(w, p, NULL, w->spill_size, count) != 0) {
+      return -1;
+    }
+    w->spill_size += size;
+    w->shuffled += count;
+  }
+
+  w->buffered = 0;
+  mr_arena_reset(&w->arena, w->spill_mark);
+  // The combiner's scratch arrays were in the memory just given back
+  w->scratch = NULL;
+  w->scratch_cap = 0;
+  w->numbers = NULL;
+  w->number_cap = 0;
+  return 0;
+}
+
+// Ends the map phase of a job with a memory budget
+// A mapper that spilled writes the rest too; otherwise its sorted runs
+// stay in memory
+// Returns 0 on success, -1 on failure
+int mr_spill_finish(struct mr_worker *w) {
+  if (w->spill_count > 0) {
+    return mr_spill(w);
+  }
+  if (w->job->opts.combine != NULL && mr_combine_local(w) != 0) {
+    return -1;
+  }
+
+  for (size_t p = 0; p < w->part_count; p++) {
+    size_t count = w->parts[p].count;
+    if (count == 0) {
+      continue;
+    }
+    struct mr_pair *pairs = sort_part(w, p);
+    if (pairs == NULL || add_run(w, p, pairs, 0, count) != 0) {
+      return -1;
+    }
+    w->shuffled += count;
+  }
+  return 0;
+}
+
+// Refills an exhausted file cursor
+// Returns 1 if pairs are buffered, 0 at the end of the run, -1 on failure
+static int cursor_fill(struct cursor *c) {
+  if (c->pos != c->end) {
+    return 1;
+  }
+  if (c->fd < 0 || c->next >= c->stop) {
+    return 0;
+  }
+
+  size_t want = (size_t)(c->stop - c->next);
+  if (want > c->buf_count * sizeof(struct mr_pair)) {
+    want = c->buf_count * sizeof(struct mr_pair);
+  }
+  if (pread(c->fd, c->buf, want, c->next) != (ssize_t)want) {
+    return -1;
+  }
+  c->next += want;
+  c->pos = c->buf;
+  c->end = c->buf + want / sizeof(struct mr_pair);
+  return 1;
+}
+
+static int read_pair(int fd, off_t offset, struct mr_pair *pair) {
+  return pread(fd, pair, sizeof(*pair), offset) == sizeof(*pair) ? 0 : -1;
+}
+
+// Index of the first pair of a run whose key is not less than key
+static size_t run_lower_bound(const struct mr_spill_run *run, int fd,
+                              const char *key, bool *failed) {
+  size_t lo = 0, hi = run->count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    struct mr_pair pair;
+    const struct mr_pair *p = &pair;
+    if (run->mem != NULL) {
+      p = &run->mem[mid];
+    } else if (read_pair(fd, run->offset + mid * sizeof(pair), &pair) != 0) {
+      *failed = true;
+      return run->count;
+    }
+    if (mr_key_cmp(p->key, key) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// Merge heap over cursors, ordered by key and then by index
+struct merge {
+  struct cursor *heap;
+  size_t count;
+  bool failed; // a spill file could not be read
+};
+
+static bool cursor_less(const struct cursor *a, const struct cursor *b) {
+  int c = mr_key_cmp(a->pos->key, b->pos->key);
+  return c < 0 || (c == 0 && a->index < b->index);
+}
+
+static void heap_down(struct merge *m, size_t i) {
+  for (;;) {
+    size_t min = i, l = 2 * i + 1, r = 2 * i + 2;
+    if (l < m->count && cursor_less(&m->heap[l], &m->heap[min])) {
+      min = l;
+    }
+    if (r < m->count && cursor_less(&m->heap[r], &m->heap[min])) {
+      min = r;
+    }
+    if (min == i) {
+      return;
+    }
+    struct cursor tmp = m->heap[i];
+    m->heap[i] = m->heap[min];
+    m->heap[min] = tmp;
+    i = min;
+  }
+}
+
+// Opens cursors on every run of the part, starting at key (NULL for the
+// start of each run)
+// Returns 0 on success, -1 on failure
+static int merge_open(struct mr_job *job, struct mr_arena *arena, size_t part,
+                      const char *key, struct merge *m) {
+  size_t total = 0;
+  for (size_t i = 0; i < job->mapper_count; i++) {
+    total += job->mappers[i].spill_count;
+  }
+
+  *m = (struct merge){.count = 0};
+  m->heap = mr_arena_alloc(arena, (total + 1) * sizeof(struct cursor));
+  if (m->heap == NULL) {
+    return -1;
+  }
+
+  // Runs are numbered in mapper and then spill order, which is emit order
+  size_t index = 0;
+  bool failed = false;
+  for (size_t i = 0; i < job->mapper_count; i++) {
+    const struct mr_worker *w = &job->mappers[i];
+    for (size_t j = 0; j < w->spill_count; j++, index++) {
+      const struct mr_spill_run *run = &w->spill_runs[j];
+      if (run->part != part) {
+        continue;
+      }
+
+      size_t first = key == NULL ? 0 : run_lower_bound(run, w->spill_fd, key,
+                                                       &failed);
+      struct cursor c = {.fd = -1, .index = index};
+      if (run->mem != NULL) {
+        c.pos = run->mem + first;
+        c.end = run->mem + run->count;
+      } else {
+        c.fd = w->spill_fd;
+        c.next = run->offset + first * sizeof(struct mr_pair);
+        c.stop = run->offset + run->count * sizeof(struct mr_pair);
+        c.buf_count = run->count - first < MR_CURSOR_PAIRS ? run->count - first
+                                                          : MR_CURSOR_PAIRS;
+        c.buf = mr_arena_alloc(arena, c.buf_count * sizeof(*c.buf));
+        failed |= c.buf == NULL;
+      }
+      int filled = failed ? 0 : cursor_fill(&c);
+      failed |= filled < 0;
+      if (filled > 0) {
+        m->heap[m->count++] = c;
+      }
+    }
+  }
+
+  for (size_t i = m->count; i-- > 0;) {
+    heap_down(m, i);
+  }
+  return failed ? -1 : 0;
+}
+
+// Next pair of the merge in key order, NULL when all runs are done
+// The pair stays valid until the next call
+static const struct mr_pair *merge_next(struct merge *m,
+                                        struct mr_pair *pair) {
+  if (m->count == 0) {
+    return NULL;
+  }
+
+  *pair = *m->heap[0].pos++;
+  int filled = cursor_fill(&m->heap[0]);
+  if (filled <= 0) {
+    m->failed |= filled < 0;
+    m->heap[0] = m->heap[--m->count];
+  }
+  heap_down(m, 0);
+  return pair;
+}
+
+// Finds each reducer's first key by streaming over all runs once
+// Distinct keys are counted and staged in a temporary file, so reducers
+// get equal contiguous key ranges as in memory
+// Returns 0 on success, -1 on failure
+int mr_spill_bounds(struct mr_job *job) {
+  size_t r_count = job->reducer_count;
+  struct merge m;
+  int fd = spill_open();
+
+  job->bounds = mr_arena_alloc(&job->arena, (r_count + 1) * MAX_KEY_SIZE);
+  job->bound_index = mr_arena_alloc(&job->arena, (r_count + 1) *
+                                                     sizeof(size_t));
+  if (fd < 0 || job->bounds == NULL || job->bound_index == NULL) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    return -1;
+  }
+  struct mr_arena_mark mark = mr_arena_mark(&job->arena);
+
+  size_t keys = 0;
+  int res = merge_open(job, &job->arena, 0, NULL, &m);
+  struct mr_pair pair, last;
+  const struct mr_pair *p;
+  while (res == 0 && (p = merge_next(&m, &pair)) != NULL) {
+    if (keys == 0 || !mr_key_eq(last.key, p->key)) {
+      res = write_all(fd, p->key, MAX_KEY_SIZE);
+      last = *p;
+      keys++;
+    }
+  }
+  res |= m.failed ? -1 : 0;
+
+  for (size_t r = 0; res == 0 && r <= r_count; r++) {
+    job->bound_index[r] = r * keys / r_count;
+    if (job->bound_index[r] < keys &&
+        pread(fd, job->bounds[r], MAX_KEY_SIZE,
+              job->bound_index[r] * MAX_KEY_SIZE) != MAX_KEY_SIZE) {
+      res = -1;
+    }
+  }
+  job->group_count = keys;
+
+  close(fd);
+  mr_arena_reset(&job->arena, mark);
+  return res;
+}
+
+// Streams the reducer's key range (or hashed bucket) out of the mappers'
+// runs and calls reduce once per key
+void mr_spill_reduce(struct mr_worker *self) {
+  struct mr_job *job = self->job;
+  bool hashed = job->opts.partition == MR_PARTITION_HASH;
+  size_t r = self->index;
+  const char *first = NULL, *stop = NULL;
+
+  if (!hashed) {
+    if (job->bound_index[r] == job->bound_index[r + 1]) {
+      return;
+    }
+    first = job->bounds[r];
+    stop = job->bound_index[r + 1] < job->group_count ? job->bounds[r + 1]
+                                                      : NULL;
+  }
+
+  struct merge m;
+  if (merge_open(job, &self->arena, hashed ? r : 0, first, &m) != 0) {
+    self->failed = true;
+    return;
+  }
+
+  struct mr_pair pair;
+  const struct mr_pair *p = merge_next(&m, &pair);
+  while (p != NULL && (stop == NULL || mr_key_cmp(p->key, stop) < 0)) {
+    struct mr_out_kv kv = {.count = 0};
+    memcpy(kv.key, p->key, MAX_KEY_SIZE);
+
+    do {
+      kv.value = mr_scratch(self, kv.count + 1);
+      if (kv.value == NULL) {
+        return;
+      }
+      memcpy(kv.value[kv.count++], p->value, MAX_VALUE_SIZE);
+      p = merge_next(&m, &pair);
+    } while (p != NULL && mr_key_eq(p->key, kv.key));
+
+    mr_reduce_kv(self, &kv);
+    self->records++;
+  }
+  self->failed |= m.failed;
+}
@@ -0,0 +1,84 @@
+#include "interface.h"
+#include "tests.h"
+#include <string.h>
+
+// Emits the word with the index of its input record
+void spl_map(const struct mr_in_kv *in_kv) {
+  mr_emit_i(in_kv->value, in_kv->key);
+}
+
+// Keeps every value, so the output shows the order reduce saw them in
+void spl_reduce(const struct mr_out_kv *inter_kv) {
+  for (size_t i = 0; i < inter_kv->count; i++) {
+    mr_emit_f(inter_kv->key, inter_kv->value[i]);
+  }
+}
+
+int spl_cmp(struct mr_output *a, struct mr_output *b) {
+  if (a->count != b->count) {
+    return -1;
+  }
+  for (size_t i = 0; i < a->count; i++) {
+    struct mr_out_kv *x = &a->kv_lst[i], *y = &b->kv_lst[i];
+    if (strcmp(x->key, y->key) != 0 || x->count != y->count) {
+      return -1;
+    }
+    for (size_t j = 0; j < x->count; j++) {
+      if (strcmp(x->value[j], y->value[j]) != 0) {
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+bool spill_map_reduce(void) {
+  struct mr_input spl_input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  struct mr_output spl_output = {NULL, 0}, mem_output = {NULL, 0};
+
+  bool res = true;
+  for (size_t i = 0; i < 2; i++) {
+    struct mr_stats stats;
+    struct mr_options opts = {
+        .partition = i == 0 ? MR_PARTITION_RANGE : MR_PARTITION_HASH,
+        .stats = &stats,
+        .memory_budget = 1024,
+    };
+
+    for (size_t m = 1; m <= MAX_THREADS; m *= 4) {
+      for (size_t r = 1; r <= MAX_THREADS; r *= 4) {
+        res = res &&
+              mr_exec_ext(&spl_input, amr_map, m, amr_reduce, r, &spl_output,
+                          &opts) == 0 &&
+              spl_output.count == 57 && amr_cmp(&spl_output) == 0 &&
+              stats.spill_runs > 0 && stats.pairs_emitted == MAX_DATA_SIZE;
+        free_output(&spl_output);
+
+        res = res &&
+              mr_exec_ext(&spl_input, spl_map, m, spl_reduce, r, &spl_output,
+                          &opts) == 0;
+        res = res &&
+              mr_exec(&spl_input, spl_map, m, spl_reduce, r, &mem_output) ==
+                  0 &&
+              spl_cmp(&spl_output, &mem_output) == 0;
+        free_output(&spl_output);
+        free_output(&mem_output);
+
+        // The combiner runs on every spill, reusing memory freed by the last
+        struct mr_options cmb_opts = opts;
+        cmb_opts.combine = cmb_combine;
+        res = res &&
+              mr_exec_ext(&spl_input, cmb_map, m, cmb_reduce, r, &spl_output,
+                          &cmb_opts) == 0 &&
+              mr_exec(&spl_input, amr_map, m, amr_reduce, r, &mem_output) ==
+                  0 &&
+              spl_cmp(&spl_output, &mem_output) == 0 && stats.spill_runs > 0;
+        free_output(&spl_output);
+        free_output(&mem_output);
+      }
+    }
+  }
+  TEST(res, 0);
+
+  return res;
+}
@@ -0,0 +1,51 @@
+#include "interface.h"
+#include "tests.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Adds up the partial counts reducers emitted for a hot key
+void hot_merge(const struct mr_out_kv *inter_kv) {
+  size_t sum = 0;
+  for (size_t i = 0; i < inter_kv->count; i++) {
+    sum += strtoull(inter_kv->value[i], NULL, 10);
+  }
+
+  char sum_str[MAX_VALUE_SIZE];
+  snprintf(sum_str, MAX_VALUE_SIZE, "%zu", sum);
+  mr_emit_f(inter_kv->key, sum_str);
+}
+
+bool split_reduce(void) {
+  struct mr_input hot_input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  struct mr_output hot_output;
+  struct mr_stats stats;
+  struct mr_options opts = {.merge = hot_merge, .stats = &stats};
+
+  // With 32 reducers, words seen more than 16 times count as hot
+  bool res = true;
+  for (size_t m = 1; m <= MAX_THREADS; m *= 4) {
+    for (size_t r = 2; r <= MAX_THREADS; r *= 4) {
+      res = res &&
+            mr_exec_ext(&hot_input, amr_map, m, amr_reduce, r, &hot_output,
+                        &opts) == 0 &&
+            hot_output.count == 57 && amr_cmp(&hot_output) == 0 &&
+            (r != 32 || stats.hot_keys > 0);
+      free_output(&hot_output);
+    }
+  }
+
+  // Hot keys are only split in the global merge of range partitioning
+  struct mr_options bad[] = {
+      {.merge = hot_merge, .partition = MR_PARTITION_HASH},
+      {.merge = hot_merge, .partition = MR_PARTITION_SAMPLE},
+      {.merge = hot_merge, .memory_budget = 1 << 20},
+      {.merge = hot_merge, .mapper_budget = 1 << 20},
+  };
+  for (size_t i = 0; i < 4; i++) {
+    res = res && mr_exec_ext(&hot_input, amr_map, 4, amr_reduce, 4,
+                             &hot_output, &bad[i]) == -1;
+  }
+  TEST(res, 0);
+
+  return res;
+}
@@ -0,0 +1,127 @@
+#include "framework.h"
+#include <time.h>
+
+static double clock_seconds(clockid_t id) {
+  struct timespec ts;
+  clock_gettime(id, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+double mr_wall_time(void) { return clock_seconds(CLOCK_MONOTONIC); }
+
+// CPU time of the calling thread
+double mr_cpu_time(void) { return clock_seconds(CLOCK_THREAD_CPUTIME_ID); }
+
+// Whether the caller asked for any timing, the clocks are not free
+bool mr_timed(const struct mr_job *job) {
+  return job->opts.stats != NULL || job->opts.thread_stats != NULL;
+}
+
+// A worker run in several passes adds up the time of each
+void mr_worker_begin(struct mr_worker *w) {
+  if (mr_timed(w->job)) {
+    w->wall -= mr_wall_time();
+    w->cpu -= mr_cpu_time();
+  }
+}
+
+void mr_worker_end(struct mr_worker *w) {
+  if (mr_timed(w->job)) {
+    w->wall += mr_wall_time();
+    w->cpu += mr_cpu_time();
+  }
+}
+
+// Charges the coordinator's time since the last lap to a phase
+// MR_PHASE_COUNT only starts the clock
+void mr_lap(struct mr_job *job, struct mr_stats *stats, enum mr_phase phase) {
+  if (!mr_timed(job)) {
+    return;
+  }
+
+  double wall = mr_wall_time(), cpu = mr_cpu_time();
+  if (phase < MR_PHASE_COUNT) {
+    stats->phases[phase].wall += wall - job->lap_wall;
+    stats->phases[phase].cpu += cpu - job->lap_cpu;
+  }
+  job->lap_wall = wall;
+  job->lap_cpu = cpu;
+}
+
+// Adds the workers' time to their phase and fills in their thread stats,
+// which start at index first
+void mr_collect_workers(struct mr_job *job, struct mr_stats *stats,
+                        const struct mr_worker *workers, size_t count,
+                        enum mr_phase phase, size_t first) {
+  struct mr_phase_stats *p = &stats->phases[phase];
+
+  for (size_t i = 0; i < count; i++) {
+    const struct mr_worker *w = &workers[i];
+    p->cpu += w->cpu;
+    if (i == 0 || w->wall < p->thread_min) {
+      p->thread_min = w->wall;
+    }
+    if (i == 0 || w->wall > p->thread_max) {
+      p->thread_max = w->wall;
+    }
+
+    if (job->opts.thread_stats != NULL) {
+      job->opts.thread_stats[first + i] = (struct mr_thread_stats){
+          .records = w->records,
+          .emitted = w->emitted,
+          .wall = w->wall,
+          .cpu = w->cpu,
+          .cpu_id = w->cpu_id,
+      };
+    }
+  }
+}
+
+static const char *phase_names[MR_PHASE_COUNT] = {"map", "shuffle", "reduce",
+                                                  "output"};
+
+void mr_stats_print(FILE *out, const struct mr_stats *stats,
+                    const struct mr_thread_stats *threads) {
+  fprintf(out, "%-8s %10s %10s %10s %10s\n", "phase", "wall_ms", "cpu_ms",
+          "min_ms", "max_ms");
+  double wall = 0, cpu = 0;
+  for (size_t i = 0; i < MR_PHASE_COUNT; i++) {
+    const struct mr_phase_stats *p = &stats->phases[i];
+    fprintf(out, "%-8s %10.3f %10.3f", phase_names[i], p->wall * 1e3,
+            p->cpu * 1e3);
+    if (i == MR_PHASE_MAP || i == MR_PHASE_REDUCE) {
+      fprintf(out, " %10.3f %10.3f\n", p->thread_min * 1e3,
+              p->thread_max * 1e3);
+    } else {
+      fprintf(out, " %10s %10s\n", "-", "-");
+    }
+    wall += p->wall;
+    cpu += p->cpu;
+  }
+  fprintf(out, "%-8s %10.3f %10.3f\n\n", "total", wall * 1e3, cpu * 1e3);
+
+  fprintf(out, "pairs_emitted  %zu (%zu bytes)\n", stats->pairs_emitted,
+          stats->bytes_emitted);
+  fprintf(out, "pairs_shuffled %zu (%zu bytes)\n", stats->pairs_shuffled,
+          stats->bytes_shuffled);
+  fprintf(out, "bytes_output   %zu\n", stats->bytes_output);
+  fprintf(out, "bytes_spilled  %zu in %zu runs\n", stats->bytes_spilled,
+          stats->spill_runs);
+  fprintf(out, "hot_keys       %zu\n", stats->hot_keys);
+  fprintf(out, "allocations    %zu\n", stats->allocations);
+
+  if (threads == NULL) {
+    return;
+  }
+  size_t count = stats->mapper_count + stats->reducer_count;
+  fprintf(out, "\n%-8s %6s %10s %10s %10s %10s %4s\n", "thread", "index",
+          "records", "emitted", "wall_ms", "cpu_ms", "on");
+  for (size_t i = 0; i < count; i++) {
+    bool mapper = i < stats->mapper_count;
+    const struct mr_thread_stats *t = &threads[i];
+    fprintf(out, "%-8s %6zu %10zu %10zu %10.3f %10.3f %4d\n",
+            mapper ? "mapper" : "reducer",
+            mapper ? i : i - stats->mapper_count, t->records, t->emitted,
+            t->wall * 1e3, t->cpu * 1e3, t->cpu_id);
+  }
+}
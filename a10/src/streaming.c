@@ -0,0 +1,78 @@
+#include "interface.h"
+#include "tests.h"
+
+// Pushes the whole input in batches of up to batch records
+static int str_push(struct mr_session *session, size_t batch) {
+  for (size_t i = 0; i < MAX_DATA_SIZE; i += batch) {
+    size_t n = MAX_DATA_SIZE - i < batch ? MAX_DATA_SIZE - i : batch;
+    if (mr_session_push(session, &ex_in_kv_lst[i], n) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+bool streaming(void) {
+  struct mr_input str_input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  struct mr_output str_output = {NULL, 0}, ref_output = {NULL, 0};
+  static const size_t batches[] = {7, 100, MAX_DATA_SIZE};
+
+  bool res = true;
+  for (size_t b = 0; b < 3; b++) {
+    for (size_t m = 1; m <= MAX_THREADS; m *= 4) {
+      for (size_t r = 1; r <= MAX_THREADS; r *= 4) {
+        // Values reach reduce in input order, as from one mr_exec
+        struct mr_session *session =
+            mr_session_open(spl_map, m, spl_reduce, r, NULL);
+        res = res && session != NULL && str_push(session, batches[b]) == 0 &&
+              mr_session_close(session, &str_output) == 0 &&
+              mr_exec(&str_input, spl_map, m, spl_reduce, r, &ref_output) ==
+                  0 &&
+              spl_cmp(&str_output, &ref_output) == 0;
+        free_output(&str_output);
+        free_output(&ref_output);
+
+        struct mr_options opts = {.combine = cmb_combine};
+        session = mr_session_open(cmb_map, m, cmb_reduce, r, &opts);
+        res = res && session != NULL && str_push(session, batches[b]) == 0 &&
+              mr_session_close(session, &str_output) == 0 &&
+              str_output.count == 57 && amr_cmp(&str_output) == 0;
+        free_output(&str_output);
+      }
+    }
+  }
+
+  // Peeking reduces what was pushed so far, and pushing goes on after it
+  struct mr_input half = {ex_in_kv_lst, MAX_DATA_SIZE / 2};
+  struct mr_session *peeked = mr_session_open(spl_map, 4, spl_reduce, 3, NULL);
+  res = res && peeked != NULL &&
+        mr_session_push(peeked, ex_in_kv_lst, MAX_DATA_SIZE / 2) == 0 &&
+        mr_session_peek(peeked, &str_output) == 0 &&
+        mr_exec(&half, spl_map, 4, spl_reduce, 3, &ref_output) == 0 &&
+        spl_cmp(&str_output, &ref_output) == 0;
+  free_output(&str_output);
+  free_output(&ref_output);
+  res = res &&
+        mr_session_push(peeked, &ex_in_kv_lst[MAX_DATA_SIZE / 2],
+                        MAX_DATA_SIZE / 2) == 0 &&
+        mr_session_peek(peeked, &str_output) == 0 &&
+        mr_exec(&str_input, spl_map, 4, spl_reduce, 3, &ref_output) == 0 &&
+        spl_cmp(&str_output, &ref_output) == 0;
+  free_output(&str_output);
+  res = res && mr_session_close(peeked, &str_output) == 0 &&
+        spl_cmp(&str_output, &ref_output) == 0;
+  free_output(&str_output);
+  free_output(&ref_output);
+  res = res && mr_session_peek(NULL, &str_output) == -1;
+
+  // Nothing pushed gives empty output; no budgets
+  struct mr_options opts = {.mapper_budget = 4096};
+  struct mr_session *session = mr_session_open(amr_map, 4, amr_reduce, 4, NULL);
+  res = res && mr_session_close(session, &str_output) == 0 &&
+        str_output.count == 0 &&
+        mr_session_open(amr_map, 4, amr_reduce, 4, &opts) == NULL &&
+        mr_session_open(amr_map, 0, amr_reduce, 4, NULL) == NULL;
+  TEST(res, 0);
+
+  return res;
+}
@@ -0,0 +1,94 @@
+#include "framework.h"
+#include <stdlib.h>
+
+// Job started by mr_submit, its arguments kept until it is done
+struct mr_handle {
+  const struct mr_input *input;
+  void (*map)(const struct mr_in_kv *);
+  size_t mapper_count;
+  void (*reduce)(const struct mr_out_kv *);
+  size_t reducer_count;
+  struct mr_options opts;
+  bool has_opts;
+  struct mr_output output;
+  int res;
+  struct mr_pool_task *task; // NULL if running on its own thread
+  pthread_t thread;
+};
+
+// Runs the job on the calling thread; its workers set mr_self on theirs,
+// so emits reach this job whatever else runs alongside
+static void *handle_run(void *arg) {
+  struct mr_handle *h = arg;
+  h->res = mr_exec_ext(h->input, h->map, h->mapper_count, h->reduce,
+                       h->reducer_count, &h->output,
+                       h->has_opts ? &h->opts : NULL);
+  return NULL;
+}
+
+struct mr_handle *mr_submit(const struct mr_input *input,
+                            void (*map)(const struct mr_in_kv *),
+                            size_t mapper_count,
+                            void (*reduce)(const struct mr_out_kv *),
+                            size_t reducer_count,
+                            const struct mr_options *options) {
+  struct mr_handle *h = malloc(sizeof(*h));
+  if (h == NULL) {
+    return NULL;
+  }
+  *h = (struct mr_handle){
+      .input = input,
+      .map = map,
+      .mapper_count = mapper_count,
+      .reduce = reduce,
+      .reducer_count = reducer_count,
+      .has_opts = options != NULL,
+  };
+  if (options != NULL) {
+    h->opts = *options;
+  }
+
+  if (h->opts.pool != NULL) {
+    h->task = mr_pool_start(h->opts.pool, handle_run, h);
+    if (h->task != NULL) {
+      return h;
+    }
+  } else if (pthread_create(&h->thread, NULL, handle_run, h) == 0) {
+    return h;
+  }
+  free(h);
+  return NULL;
+}
+
+// Frees an output nobody waited for, however the job built it
+static void output_free(const struct mr_options *opts,
+                        struct mr_output *output) {
+  if (opts->arena_output || opts->direct_output) {
+    mr_release_output(output);
+    return;
+  }
+  for (size_t i = 0; i < output->count; i++) {
+    free(output->kv_lst[i].value);
+  }
+  free(output->kv_lst);
+}
+
+int mr_wait(struct mr_handle *handle, struct mr_output *output) {
+  if (handle == NULL) {
+    return -1;
+  }
+  if (handle->task != NULL) {
+    mr_pool_join(handle->task);
+  } else {
+    pthread_join(handle->thread, NULL);
+  }
+
+  int res = handle->res;
+  if (output != NULL) {
+    *output = handle->output;
+  } else {
+    output_free(&handle->opts, &handle->output);
+  }
+  free(handle);
+  return res;
+}
@@ -0,0 +1,96 @@
+#include "interface.h"
+#include "tests.h"
+#include <stdlib.h>
+#include <string.h>
+
+void typ_map(const struct mr_in_kv *in_kv) { mr_emit_i_u64(in_kv->value, 1); }
+
+void typ_reduce(const struct mr_out_u64 *inter_kv) {
+  uint64_t cnt = 0;
+  for (size_t i = 0; i < inter_kv->count; i++) {
+    cnt += inter_kv->value[i];
+  }
+  mr_emit_f_u64(inter_kv->key, cnt);
+}
+
+void typ_map_f64(const struct mr_in_kv *in_kv) {
+  mr_emit_i_f64(in_kv->value, 0.5);
+}
+
+// Emits twice the sum, so the output is the word count again
+void typ_reduce_f64(const struct mr_out_f64 *inter_kv) {
+  double sum = 0;
+  for (size_t i = 0; i < inter_kv->count; i++) {
+    sum += inter_kv->value[i];
+  }
+  mr_emit_f_f64(inter_kv->key, 2 * sum);
+}
+
+// String emits are refused in a typed job
+void typ_map_string(const struct mr_in_kv *in_kv) {
+  if (mr_emit_i(in_kv->value, "1") == 0) {
+    abort();
+  }
+  mr_emit_i_u64(in_kv->value, 1);
+}
+
+static void typ_release(struct mr_output *output,
+                        const struct mr_options *opts) {
+  if (opts->arena_output || opts->direct_output) {
+    mr_release_output(output);
+  } else {
+    free_output(output);
+  }
+}
+
+bool typed_reduce(void) {
+  struct mr_input typ_input = {ex_in_kv_lst, MAX_DATA_SIZE};
+  struct mr_output typ_output = {NULL, 0};
+
+  struct mr_options variants[] = {
+      {.partition = MR_PARTITION_RANGE},
+      {.partition = MR_PARTITION_HASH},
+      {.partition = MR_PARTITION_SAMPLE, .direct_output = true},
+      {.partition = MR_PARTITION_RANGE, .memory_budget = 1024},
+  };
+
+  bool res = true;
+  for (size_t v = 0; v < sizeof(variants) / sizeof(*variants); v++) {
+    for (size_t m = 1; m <= MAX_THREADS; m *= 4) {
+      for (size_t r = 1; r <= MAX_THREADS; r *= 4) {
+        struct mr_options opts = variants[v];
+        opts.reduce_u64 = typ_reduce;
+        res = res &&
+              mr_exec_ext(&typ_input, typ_map, m, NULL, r, &typ_output,
+                          &opts) == 0 &&
+              typ_output.count == 57 && amr_cmp(&typ_output) == 0;
+        typ_release(&typ_output, &opts);
+
+        opts.reduce_u64 = NULL;
+        opts.reduce_f64 = typ_reduce_f64;
+        res = res &&
+              mr_exec_ext(&typ_input, typ_map_f64, m, NULL, r, &typ_output,
+                          &opts) == 0 &&
+              typ_output.count == 57 && amr_cmp(&typ_output) == 0;
+        typ_release(&typ_output, &opts);
+      }
+    }
+  }
+
+  struct mr_options opts = {.reduce_u64 = typ_reduce};
+  res = res &&
+        mr_exec_ext(&typ_input, typ_map_string, 4, NULL, 4, &typ_output,
+                    &opts) == 0 &&
+        amr_cmp(&typ_output) == 0;
+  free_output(&typ_output);
+
+  // Numbers never reach a string combiner, nor a string reduce
+  opts.combine = amr_reduce;
+  res = res && mr_exec_ext(&typ_input, typ_map, 1, amr_reduce, 1, &typ_output,
+                           &opts) == -1;
+  res = res && mr_exec_ext(&typ_input, typ_map, 1, NULL, 1, &typ_output,
+                           NULL) == -1;
+  TEST(res, 0);
+
+  return res;
+}
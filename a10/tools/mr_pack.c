@@ -0,0 +1,145 @@
+// Packs text into a file of mr_in_kv records for mr_input_map
+//
+// By default every line is one record: the key is the first word and the
+// value is the rest of the line, trimmed. A line with a single word gets
+// its line number as the key. With -w every word becomes a record keyed by
+// its position, like the word-count test input.
+// Fields longer than MAX_KEY_SIZE - 1 or MAX_VALUE_SIZE - 1 are truncated.
+#include "interface.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static size_t truncated = 0;
+
+static void set_field(char *dst, const char *src, size_t len, size_t size) {
+  if (len > size - 1) {
+    len = size - 1;
+    truncated++;
+  }
+  memset(dst, 0, size);
+  memcpy(dst, src, len);
+}
+
+static int put(FILE *out, const char *key, size_t key_len, const char *value,
+               size_t value_len) {
+  struct mr_in_kv kv;
+  set_field(kv.key, key, key_len, MAX_KEY_SIZE);
+  set_field(kv.value, value, value_len, MAX_VALUE_SIZE);
+  return fwrite(&kv, sizeof(kv), 1, out) == 1 ? 0 : -1;
+}
+
+static int put_indexed(FILE *out, size_t index, const char *value,
+                       size_t value_len) {
+  char key[MAX_KEY_SIZE];
+  int len = snprintf(key, sizeof(key), "%zu", index);
+  return put(out, key, (size_t)len, value, value_len);
+}
+
+// Packs one line, returns the records written or -1 on failure
+static int pack_line(FILE *out, char *line, size_t *index, bool words) {
+  char *p = line;
+  int n = 0;
+
+  if (words) {
+    for (;;) {
+      while (isspace((unsigned char)*p)) {
+        p++;
+      }
+      if (*p == '\0') {
+        return n;
+      }
+      char *word = p;
+      while (*p != '\0' && !isspace((unsigned char)*p)) {
+        p++;
+      }
+      if (put_indexed(out, (*index)++, word, p - word) != 0) {
+        return -1;
+      }
+      n++;
+    }
+  }
+
+  while (isspace((unsigned char)*p)) {
+    p++;
+  }
+  char *end = p + strlen(p);
+  while (end > p && isspace((unsigned char)end[-1])) {
+    end--;
+  }
+  if (p == end) {
+    return 0;
+  }
+
+  char *key_end = p;
+  while (key_end < end && !isspace((unsigned char)*key_end)) {
+    key_end++;
+  }
+  char *value = key_end;
+  while (value < end && isspace((unsigned char)*value)) {
+    value++;
+  }
+
+  int res = value == end ? put_indexed(out, *index, p, end - p)
+                         : put(out, p, key_end - p, value, end - value);
+  (*index)++;
+  return res == 0 ? 1 : -1;
+}
+
+int main(int argc, char *argv[]) {
+  bool words = argc > 1 && strcmp(argv[1], "-w") == 0;
+  int arg = words ? 2 : 1;
+  if (argc - arg != 2) {
+    fprintf(stderr, "usage: %s [-w] input.txt|- output.bin\n", argv[0]);
+    return 2;
+  }
+
+  FILE *in = strcmp(argv[arg], "-") == 0 ? stdin : fopen(argv[arg], "r");
+  if (in == NULL) {
+    perror(argv[arg]);
+    return 1;
+  }
+  FILE *out = fopen(argv[arg + 1], "wb");
+  if (out == NULL) {
+    perror(argv[arg + 1]);
+    if (in != stdin) {
+      fclose(in);
+    }
+    return 1;
+  }
+
+  char *line = NULL;
+  size_t cap = 0, index = 0, records = 0;
+  int res = 0;
+  while (res >= 0 && getline(&line, &cap, in) != -1) {
+    res = pack_line(out, line, &index, words);
+    records += res > 0 ? res : 0;
+  }
+  free(line);
+
+  // Names the file that failed, reading taking precedence, with its errno
+  const char *failed = ferror(in) ? argv[arg] : res < 0 ? argv[arg + 1] : NULL;
+  int err = errno;
+  if (fclose(out) != 0 && failed == NULL) {
+    failed = argv[arg + 1];
+    err = errno;
+  }
+  if (in != stdin) {
+    fclose(in);
+  }
+  if (failed != NULL) {
+    errno = err;
+    perror(failed);
+    return 1;
+  }
+
+  fprintf(stderr, "%zu records", records);
+  if (truncated > 0) {
+    fprintf(stderr, ", %zu fields truncated", truncated);
+  }
+  fprintf(stderr, "\n");
+  return 0;
+}